@@ -7,7 +7,7 @@
 // controller is in write mode.
 
 #include "SdFat.h"
-#include "RingBuf.h"
+#include "LogPump.h"
 
 // Use Teensy SDIO
 #define SD_CONFIG  SdioConfig(FIFO_SDIO)
@@ -28,6 +28,9 @@ FsFile file;
 // RingBuf for File type FsFile.
 RingBuf<FsFile, RING_BUF_CAPACITY> rb;
 
+// Writes RingBuf data to the file when the SD is not busy.
+LogPump<FsFile, RING_BUF_CAPACITY> pump;
+
 void logData() {
   // Initialize the SD.
   if (!sd.begin(SD_CONFIG)) {
@@ -45,13 +48,13 @@ void logData() {
      file.close();
      return;
   }
-  // initialize the RingBuf.
-  rb.begin(&file);
+  // initialize the RingBuf and LogPump.
+  pump.begin(&rb, &file, LOG_FILE_SIZE);
+  // Only single sector writes when the SD is idle.  A high water mark,
+  // for example pump.setHighWater(RING_BUF_CAPACITY/2), catches up with
+  // multi-sector writes but the loop stalls while they finish.
   Serial.println("Type any character to stop");
 
-  // Max RingBuf used bytes. Useful to understand RingBuf overrun.
-  size_t maxUsed = 0;
-
   // Min spare micros in loop.
   int32_t minSpareMicros = INT32_MAX;
 
@@ -59,22 +62,15 @@ void logData() {
   uint32_t logTime = micros();
   // Log data until Serial input or file full.
   while (!Serial.available()) {
-    // Amount of data in ringBuf.
-    size_t n = rb.bytesUsed();
-    if ((n + file.curPosition()) > (LOG_FILE_SIZE - 20)) {
+    // Leave space for one more line.
+    if (pump.isFull(20)) {
       Serial.println("File full - quiting.");
       break;
     }
-    if (n > maxUsed) {
-      maxUsed = n;
-    }
-    if (n >= 512 && !file.isBusy()) {
-      // Not busy only allows one sector before possible busy wait.
-      // Write one sector from RingBuf to file.
-      if (512 != rb.writeOut(512)) {
-        Serial.println("writeOut failed");
-        break;
-      }
+    // Write a sector from RingBuf to file if the SD is not busy.
+    if (!pump.poll()) {
+      Serial.println("writeOut failed");
+      break;
     }
     // Time for next point.
     logTime += LOG_INTERVAL_USEC;
@@ -103,9 +99,8 @@ void logData() {
       break;
     }
   }
-  // Write any RingBuf data to file.
-  rb.sync();
-  file.truncate();
+  // Write any RingBuf data to file and truncate preallocated space.
+  pump.end();
   file.rewind();
   // Print first twenty lines of file.
   Serial.println("spareMicros,ADC0");
@@ -120,7 +115,7 @@ void logData() {
   Serial.print("fileSize: ");
   Serial.println((uint32_t)file.fileSize());
   Serial.print("maxBytesUsed: ");
-  Serial.println(maxUsed);
+  Serial.println(pump.maxBytesUsed());
   Serial.print("minSpareMicros: ");
   Serial.println(minSpareMicros);
   file.close();
@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+// Host program to build a bundle for the AssetBundle class.
+// Layout must match AssetBundle.h.
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+struct Asset {
+  std::string name;
+  std::string path;
+  uint32_t hash;
+  uint32_t nameOffset;
+  uint32_t sector;
+  uint32_t size;
+};
+//------------------------------------------------------------------------------
+// Must match assetHash() in AssetBundle.cpp.
+static uint32_t assetHash(const char* name) {
+  uint32_t h = 2166136261UL;
+  while (*name) {
+    h = (h ^ (uint8_t)*name++)*16777619UL;
+  }
+  return h;
+}
+//------------------------------------------------------------------------------
+static uint32_t assetChecksum(uint32_t sum, const uint8_t* data, size_t n) {
+  while (n--) {
+    sum = ((sum << 1) | (sum >> 31)) + *data++;
+  }
+  return sum;
+}
+//------------------------------------------------------------------------------
+static void setLe32(uint8_t* dst, uint32_t v) {
+  for (int i = 0; i < 4; i++) {
+    dst[i] = v >> 8*i;
+  }
+}
+//------------------------------------------------------------------------------
+static int usage() {
+  fprintf(stderr,
+    "usage: assetpack [-C dir] bundle file...\n"
+    "  -C  read files relative to dir, names are as given\n");
+  return 1;
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  std::vector<Asset> assets;
+  std::vector<uint8_t> image;
+  std::string dir;
+  FILE* out;
+  int i = 1;
+  if (i + 1 < argc && strcmp(argv[i], "-C") == 0) {
+    dir = std::string(argv[i + 1]) + "/";
+    i += 2;
+  }
+  if (argc - i < 2) {
+    return usage();
+  }
+  const char* bundle = argv[i++];
+  for (; i < argc; i++) {
+    Asset a;
+    a.name = argv[i];
+    a.path = dir + a.name;
+    if (a.name.empty() || a.name.size() > 255) {
+      fprintf(stderr, "bad name: %s\n", argv[i]);
+      return 1;
+    }
+    a.hash = assetHash(a.name.c_str());
+    assets.push_back(a);
+  }
+  if (assets.size() > 0XFFFF) {
+    fprintf(stderr, "too many assets\n");
+    return 1;
+  }
+  std::sort(assets.begin(), assets.end(),
+            [](const Asset& a, const Asset& b) {
+              return a.hash != b.hash ? a.hash < b.hash : a.name < b.name;
+            });
+  for (size_t k = 1; k < assets.size(); k++) {
+    if (assets[k].name == assets[k - 1].name) {
+      fprintf(stderr, "duplicate name: %s\n", assets[k].name.c_str());
+      return 1;
+    }
+  }
+  // Names follow the index and never span sectors.
+  size_t pos = 16 + 16*assets.size();
+  for (Asset& a : assets) {
+    size_t n = a.name.size() + 1;
+    if ((pos & 511) + n > 512) {
+      pos = (pos + 511) & ~(size_t)511;
+    }
+    a.nameOffset = pos;
+    pos += n;
+  }
+  image.resize((pos + 511) & ~(size_t)511);
+  for (Asset& a : assets) {
+    memcpy(&image[a.nameOffset], a.name.c_str(), a.name.size() + 1);
+    FILE* in = fopen(a.path.c_str(), "rb");
+    if (!in) {
+      fprintf(stderr, "open failed: %s\n", a.path.c_str());
+      return 1;
+    }
+    a.sector = image.size() >> 9;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+      image.insert(image.end(), buf, buf + n);
+    }
+    fclose(in);
+    a.size = image.size() - 512*(size_t)a.sector;
+    // Data starts on a sector boundary.
+    image.resize((image.size() + 511) & ~(size_t)511);
+    if (image.size() > 0XFFFFFFFF) {
+      fprintf(stderr, "bundle too large\n");
+      return 1;
+    }
+  }
+  setLe32(&image[0], 0X314E4241);  // "ABN1"
+  setLe32(&image[4], assets.size());
+  setLe32(&image[8], image.size() >> 9);
+  for (size_t k = 0; k < assets.size(); k++) {
+    uint8_t* e = &image[16 + 16*k];
+    setLe32(e, assets[k].hash);
+    setLe32(e + 4, assets[k].nameOffset);
+    setLe32(e + 8, assets[k].sector);
+    setLe32(e + 12, assets[k].size);
+  }
+  uint32_t sum = assetChecksum(0, &image[0], 12);
+  sum = assetChecksum(sum, &image[16], 16*assets.size());
+  setLe32(&image[12], sum);
+  out = fopen(bundle, "wb");
+  if (!out || fwrite(image.data(), 1, image.size(), out) != image.size() ||
+      fclose(out) != 0) {
+    fprintf(stderr, "write failed: %s\n", bundle);
+    return 1;
+  }
+  printf("%zu assets, %zu bytes\n", assets.size(), image.size());
+  return 0;
+}
@@ -0,0 +1,271 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <thread>
+#include "BinToCsv.h"
+#include "../../src/common/FmtNumber.h"
+#include "../../examples/AvrAdcLogger/AvrAdcLogger.h"
+#include "../../examples/ExFatLogger/ExFatLogger.h"
+
+// ExFatLogger writes data after one header sector.
+const size_t EXFAT_LOGGER_HEADER = 512;
+// Longest ExFatLogger row.
+const size_t EXFAT_ROW_DIM = 11 + FMT_ROW_U16_DIM(ADC_COUNT);
+// Longest AvrAdcLogger block.
+const size_t AVR_BLOCK_DIM = 20 + DATA_DIM8*6 + 2;
+//------------------------------------------------------------------------------
+static char* putStr(char* dst, const char* str) {
+  size_t n = strlen(str);
+  memcpy(dst, str, n);
+  return dst + n;
+}
+//------------------------------------------------------------------------------
+static char* putU32(char* dst, uint32_t n) {
+  char buf[10];
+  char* str = fmtBase10(buf + sizeof(buf), n);
+  size_t k = buf + sizeof(buf) - str;
+  memcpy(dst, str, k);
+  return dst + k;
+}
+//==============================================================================
+void PosixBinSource::close() {
+  if (m_fd >= 0) {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+}
+//------------------------------------------------------------------------------
+bool PosixBinSource::open(const char* path) {
+  close();
+  m_fd = ::open(path, O_RDONLY);
+  return m_fd >= 0;
+}
+//------------------------------------------------------------------------------
+int PosixBinSource::read(void* buf, size_t n) {
+  uint8_t* dst = reinterpret_cast<uint8_t*>(buf);
+  size_t nr = 0;
+  while (nr < n) {
+    ssize_t k = ::read(m_fd, dst + nr, n - nr);
+    if (k < 0) {
+      return -1;
+    }
+    if (k == 0) {
+      break;
+    }
+    nr += k;
+  }
+  return nr;
+}
+//==============================================================================
+BinToCsv::BinToCsv() : m_chunkSize(1UL << 20), m_errorMsg(""),
+  m_logIntervalUsec(2000), m_pinCount(0), m_eightBits(false) {
+  setThreadCount(0);
+}
+//------------------------------------------------------------------------------
+bool BinToCsv::convert(Format format, BinSource* src, FILE* csv) {
+  m_errorMsg = "";
+  m_in.resize(m_threadCount);
+  m_out.resize(m_threadCount);
+  return format == EXFAT_LOGGER ? convertExFat(src, csv)
+                                : convertAvrAdc(src, csv);
+}
+//------------------------------------------------------------------------------
+bool BinToCsv::convertAvrAdc(BinSource* src, FILE* csv) {
+  char buf[32];
+  metadata_t meta;
+  if (src->read(&meta, sizeof(meta)) != sizeof(meta)) {
+    return error("read metadata failed");
+  }
+  if (meta.pinCount == 0 || meta.pinCount > PIN_NUM_DIM ||
+      meta.cpuFrequency == 0) {
+    return error("invalid metadata");
+  }
+  m_pinCount = meta.pinCount;
+  m_eightBits = meta.recordEightBits;
+  float intervalMicros = 1.0e6*meta.sampleInterval/(float)meta.cpuFrequency;
+  char* end = buf + sizeof(buf);
+  char* str = fmtDouble(end, intervalMicros, 4, false);
+  fprintf(csv, "Interval,%.*s,usec\r\n", static_cast<int>(end - str), str);
+  for (uint8_t i = 0; i < m_pinCount; i++) {
+    fprintf(csv, "%spin%u", i ? "," : "", meta.pinNumber[i]);
+  }
+  fprintf(csv, "\r\n");
+  while (size_t n = readChunks(src, BLOCK_SIZE)) {
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < n; i++) {
+      threads.push_back(std::thread(&BinToCsv::formatAvrAdc, this,
+                                    &m_in[i], &m_out[i]));
+    }
+    formatAvrAdc(&m_in[0], &m_out[0]);
+    for (size_t i = 0; i < threads.size(); i++) {
+      threads[i].join();
+    }
+    if (!writeChunks(csv, n)) {
+      return false;
+    }
+  }
+  return !*m_errorMsg;
+}
+//------------------------------------------------------------------------------
+bool BinToCsv::convertExFat(BinSource* src, FILE* csv) {
+  char header[EXFAT_LOGGER_HEADER];
+  if (src->read(header, sizeof(header)) != sizeof(header)) {
+    return error("read header failed");
+  }
+  fprintf(csv, "LOG_INTERVAL_USEC,%lu\r\nrec#",
+          static_cast<unsigned long>(m_logIntervalUsec));
+  for (size_t i = 0; i < ADC_COUNT; i++) {
+    fprintf(csv, ",adc%u", static_cast<unsigned>(i));
+  }
+  fprintf(csv, "\r\n");
+  uint32_t nr = 0;
+  std::vector<uint32_t> start(m_threadCount);
+  while (size_t n = readChunks(src, sizeof(data_t))) {
+    // Record numbers depend on overruns in earlier chunks.
+    for (size_t i = 0; i < n; i++) {
+      start[i] = nr;
+      size_t count = m_in[i].size()/sizeof(data_t);
+      for (size_t k = 0; k < count; k++) {
+        uint16_t adc0;
+        memcpy(&adc0, &m_in[i][k*sizeof(data_t)], sizeof(adc0));
+        nr += adc0 & 0X8000 ? adc0 & 0X7FFF : 1;
+      }
+    }
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < n; i++) {
+      threads.push_back(std::thread(&BinToCsv::formatExFat, this,
+                                    &m_in[i], start[i], &m_out[i]));
+    }
+    formatExFat(&m_in[0], start[0], &m_out[0]);
+    for (size_t i = 0; i < threads.size(); i++) {
+      threads[i].join();
+    }
+    if (!writeChunks(csv, n)) {
+      return false;
+    }
+  }
+  return !*m_errorMsg;
+}
+//------------------------------------------------------------------------------
+void BinToCsv::formatAvrAdc(const Buffer* in, Buffer* out) const {
+  size_t count = in->size()/BLOCK_SIZE;
+  out->resize(count*AVR_BLOCK_DIM);
+  char* dst = out->data();
+  uint16_t row[PIN_NUM_DIM];
+  for (size_t b = 0; b < count; b++) {
+    const char* src = in->data() + b*BLOCK_SIZE;
+    uint16_t n;
+    uint16_t overrun;
+    memcpy(&n, src, sizeof(n));
+    memcpy(&overrun, src + sizeof(n), sizeof(overrun));
+    src += 2*sizeof(uint16_t);
+    if (overrun) {
+      dst = putStr(dst, "OVERRUN,");
+      dst = putU32(dst, overrun);
+      dst = putStr(dst, "\r\n");
+    }
+    // Same limit as BLOCK_MAX_COUNT so a row stays in the block.
+    size_t dim = m_eightBits ? DATA_DIM8 : DATA_DIM16;
+    dim -= dim % m_pinCount;
+    if (n > dim) {
+      n = dim;
+    }
+    // As in binaryToCsv(), a partial last row prints all pins.
+    for (size_t j = 0; j < n; j += m_pinCount) {
+      for (size_t i = 0; i < m_pinCount; i++) {
+        if (m_eightBits) {
+          row[i] = static_cast<uint8_t>(src[j + i]);
+        } else {
+          memcpy(&row[i], src + 2*(j + i), sizeof(uint16_t));
+        }
+      }
+      dst = fmtRowU16(dst, row, m_pinCount, ',');
+    }
+  }
+  out->resize(dst - out->data());
+}
+//------------------------------------------------------------------------------
+void BinToCsv::formatExFat(const Buffer* in, uint32_t nr, Buffer* out) const {
+  size_t count = in->size()/sizeof(data_t);
+  out->resize(count*EXFAT_ROW_DIM);
+  char* dst = out->data();
+  for (size_t k = 0; k < count; k++) {
+    data_t data;
+    memcpy(&data, in->data() + k*sizeof(data_t), sizeof(data_t));
+    if (data.adc[0] & 0X8000) {
+      uint16_t n = data.adc[0] & 0X7FFF;
+      nr += n;
+      dst = putStr(dst, "-1,");
+      dst = putU32(dst, n);
+      dst = putStr(dst, ",overuns\r\n");
+    } else {
+      dst = putU32(dst, nr++);
+      *dst++ = ',';
+      dst = fmtRowU16(dst, data.adc, ADC_COUNT, ',');
+    }
+  }
+  out->resize(dst - out->data());
+}
+//------------------------------------------------------------------------------
+// Read up to one chunk per thread.  Return number of non-empty chunks.
+size_t BinToCsv::readChunks(BinSource* src, size_t recordSize) {
+  size_t chunk = m_chunkSize < recordSize ? recordSize
+                 : m_chunkSize - m_chunkSize%recordSize;
+  for (size_t i = 0; i < m_threadCount; i++) {
+    m_in[i].resize(chunk);
+    int nb = src->read(m_in[i].data(), chunk);
+    if (nb < 0) {
+      error("read failed");
+      return 0;
+    }
+    // Ignore a partial record at end of file.
+    m_in[i].resize(nb - nb%recordSize);
+    if (m_in[i].empty()) {
+      return i;
+    }
+    if (static_cast<size_t>(nb) < chunk) {
+      return i + 1;
+    }
+  }
+  return m_threadCount;
+}
+//------------------------------------------------------------------------------
+void BinToCsv::setThreadCount(unsigned n) {
+  if (n == 0) {
+    n = std::thread::hardware_concurrency();
+  }
+  m_threadCount = n ? n : 1;
+}
+//------------------------------------------------------------------------------
+bool BinToCsv::writeChunks(FILE* csv, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (fwrite(m_out[i].data(), 1, m_out[i].size(), csv) != m_out[i].size()) {
+      return error("write csv failed");
+    }
+  }
+  return true;
+}
@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BinToCsv_h
+#define BinToCsv_h
+/**
+ * \file
+ * \brief Host converter for ExFatLogger and AvrAdcLogger binary files.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+//------------------------------------------------------------------------------
+/**
+ * \class BinSource
+ * \brief Sequential source of binary log data.
+ */
+class BinSource {
+ public:
+  virtual ~BinSource() {}
+  /** Read data.
+   * \param[out] buf Location for data.
+   * \param[in] n Number of bytes requested.
+   * \return Number of bytes read, zero at end of file, or -1 for error.
+   */
+  virtual int read(void* buf, size_t n) = 0;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class PosixBinSource
+ * \brief Read a .bin file copied from the card.
+ */
+class PosixBinSource : public BinSource {
+ public:
+  PosixBinSource() : m_fd(-1) {}
+  ~PosixBinSource() {close();}
+  /** Close the file. */
+  void close();
+  /** Open a file.
+   * \param[in] path File path.
+   * \return true for success or false for failure.
+   */
+  bool open(const char* path);
+  int read(void* buf, size_t n);
+
+ private:
+  int m_fd;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class BinToCsv
+ * \brief Convert logger binary files to CSV using several threads.
+ *
+ * Input is read in chunks by the calling thread.  Chunks are formatted
+ * in parallel then written in order so the CSV file is identical to the
+ * file made by the binaryToCsv() function of the logger sketch.
+ */
+class BinToCsv {
+ public:
+  /** Binary file layouts. */
+  enum Format {
+    /** data_t records from ExFatLogger.h after a 512 byte header. */
+    EXFAT_LOGGER,
+    /** metadata_t then block8_t or block16_t from AvrAdcLogger.h. */
+    AVR_ADC_LOGGER
+  };
+  BinToCsv();
+  /** Convert a binary file.
+   * \param[in] format Layout of the binary file.
+   * \param[in] src Binary file.
+   * \param[in] csv Output file.
+   * \return true for success or false for failure.
+   */
+  bool convert(Format format, BinSource* src, FILE* csv);
+  /** \return Description of the last error. */
+  const char* errorMsg() const {return m_errorMsg;}
+  /** Set input chunk size.
+   * \param[in] bytes Bytes of input formatted by one thread at a time.
+   */
+  void setChunkSize(size_t bytes) {m_chunkSize = bytes ? bytes : 1;}
+  /** Set LOG_INTERVAL_USEC used by ExFatLogger.
+   * \param[in] usec Value printed in the CSV header.
+   */
+  void setLogIntervalUsec(uint32_t usec) {m_logIntervalUsec = usec;}
+  /** Set number of formatting threads.
+   * \param[in] n Thread count.  Zero selects the number of CPUs.
+   */
+  void setThreadCount(unsigned n);
+
+ private:
+  typedef std::vector<char> Buffer;
+  bool convertAvrAdc(BinSource* src, FILE* csv);
+  bool convertExFat(BinSource* src, FILE* csv);
+  void formatAvrAdc(const Buffer* in, Buffer* out) const;
+  void formatExFat(const Buffer* in, uint32_t nr, Buffer* out) const;
+  bool error(const char* msg) {
+    m_errorMsg = msg;
+    return false;
+  }
+  size_t readChunks(BinSource* src, size_t recordSize);
+  bool writeChunks(FILE* csv, size_t count);
+
+  size_t m_chunkSize;
+  const char* m_errorMsg;
+  uint32_t m_logIntervalUsec;
+  uint8_t m_pinCount;
+  bool m_eightBits;
+  unsigned m_threadCount;
+  std::vector<Buffer> m_in;
+  std::vector<Buffer> m_out;
+};
+#endif  // BinToCsv_h
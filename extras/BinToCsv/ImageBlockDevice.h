@@ -0,0 +1,110 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef ImageBlockDevice_h
+#define ImageBlockDevice_h
+/**
+ * \file
+ * \brief Block device for a card image file on a POSIX host.
+ *
+ * The library must be configured with USE_BLOCK_DEVICE_INTERFACE nonzero.
+ */
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "SdFat.h"
+#include "BinToCsv.h"
+//------------------------------------------------------------------------------
+/**
+ * \class ImageBlockDevice
+ * \brief Read only access to a card image or a raw card device.
+ */
+class ImageBlockDevice : public BlockDeviceInterface {
+ public:
+  ImageBlockDevice() : m_file(nullptr), m_sectorCount(0) {}
+  ~ImageBlockDevice() {
+    if (m_file) {
+      fclose(m_file);
+    }
+  }
+  /** Open an image.
+   * \param[in] path Image file or device path.
+   * \return true for success or false for failure.
+   */
+  bool open(const char* path) {
+    // Use stdio since fcntl.h conflicts with library O_ flags.
+    struct stat st;
+    m_file = fopen(path, "rb");
+    if (!m_file) {
+      return false;
+    }
+    int fd = fileno(m_file);
+    off_t size = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) ?
+                 st.st_size : lseek(fd, 0, SEEK_END);
+    m_sectorCount = size > 0 ? size/512 : 0;
+    return m_sectorCount != 0;
+  }
+  bool isBusy() {return false;}
+  bool readSector(uint32_t sector, uint8_t* dst) {
+    return readSectors(sector, dst, 1);
+  }
+  bool readSectors(uint32_t sector, uint8_t* dst, size_t ns) {
+    size_t n = 512*ns;
+    return pread(fileno(m_file), dst, n, 512*(off_t)sector) == (ssize_t)n;
+  }
+  uint32_t sectorCount() {return m_sectorCount;}
+  bool syncDevice() {return true;}
+  bool writeSector(uint32_t sector, const uint8_t* src) {
+    (void)sector;
+    (void)src;
+    return false;
+  }
+  bool writeSectors(uint32_t sector, const uint8_t* src, size_t ns) {
+    (void)sector;
+    (void)src;
+    (void)ns;
+    return false;
+  }
+
+ private:
+  FILE* m_file;
+  uint32_t m_sectorCount;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class FsFileBinSource
+ * \brief Read a binary log file through the FAT/exFAT library.
+ */
+class FsFileBinSource : public BinSource {
+ public:
+  /** Constructor.
+   * \param[in] file Open file.
+   */
+  explicit FsFileBinSource(FsBaseFile* file) : m_file(file) {}
+  int read(void* buf, size_t n) {return m_file->read(buf, n);}
+
+ private:
+  FsBaseFile* m_file;
+};
+#endif  // ImageBlockDevice_h
@@ -0,0 +1,155 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+// Minimal Arduino core for building the library on a host with USE_IMAGE.
+#ifndef Arduino_h
+#define Arduino_h
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifndef ARDUINO
+#define ARDUINO 10813
+#endif  // ARDUINO
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define SS 0
+class __FlashStringHelper;
+#define F(str) (reinterpret_cast<const __FlashStringHelper*>(str))
+//------------------------------------------------------------------------------
+inline uint32_t millis() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec*1000UL + ts.tv_nsec/1000000UL;
+}
+inline void delay(uint32_t ms) {
+  uint32_t m = millis();
+  while ((millis() - m) < ms) {}
+}
+inline void digitalWrite(uint8_t pin, uint8_t value) {
+  (void)pin;
+  (void)value;
+}
+inline void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+inline void yield() {}
+//------------------------------------------------------------------------------
+/** Print to a host FILE, stdout by default. */
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t b) {return fputc(b, stdout) == EOF ? 0 : 1;}
+  virtual size_t write(const uint8_t* buf, size_t n) {
+    size_t rtn = 0;
+    while (n--) {
+      rtn += write(*buf++);
+    }
+    return rtn;
+  }
+  virtual int availableForWrite() {return 0;}
+  virtual void flush() {}
+  size_t write(const char* str) {
+    return write(reinterpret_cast<const uint8_t*>(str), strlen(str));
+  }
+  size_t write(const char* buf, size_t n) {
+    return write(reinterpret_cast<const uint8_t*>(buf), n);
+  }
+  size_t print(const char* str) {return write(str);}
+  size_t print(const __FlashStringHelper* str) {
+    return write(reinterpret_cast<const char*>(str));
+  }
+  size_t print(char c) {return write(static_cast<uint8_t>(c));}
+  size_t print(unsigned long n, int base = DEC) {
+    char buf[sizeof(n)*8 + 1];
+    char* str = buf + sizeof(buf);
+    *--str = 0;
+    if (base < 2) {
+      base = DEC;
+    }
+    do {
+      uint8_t d = n % base;
+      *--str = d < 10 ? '0' + d : 'A' + d - 10;
+      n /= base;
+    } while (n);
+    return write(str);
+  }
+  size_t print(long n, int base = DEC) {
+    if (n < 0 && base == DEC) {
+      return print('-') + print(0UL - n, base);
+    }
+    return print(static_cast<unsigned long>(n), base);
+  }
+  size_t print(unsigned n, int base = DEC) {
+    return print(static_cast<unsigned long>(n), base);
+  }
+  size_t print(int n, int base = DEC) {
+    return print(static_cast<long>(n), base);
+  }
+  size_t print(unsigned char n, int base = DEC) {
+    return print(static_cast<unsigned long>(n), base);
+  }
+  size_t print(double d, int digits = 2) {
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%.*f", digits, d);
+    return write(buf);
+  }
+  size_t println() {return write("\r\n");}
+  template<typename T> size_t println(T value) {
+    size_t rtn = print(value);
+    return rtn + println();
+  }
+  template<typename T> size_t println(T value, int arg) {
+    size_t rtn = print(value, arg);
+    return rtn + println();
+  }
+};
+//------------------------------------------------------------------------------
+/** Stream without input. */
+class Stream : public Print {
+ public:
+  virtual int available() {return 0;}
+  virtual int peek() {return -1;}
+  virtual int read() {return -1;}
+};
+/** Serial writes to stdout. */
+static Stream Serial;
+//------------------------------------------------------------------------------
+/** String that holds a pointer to a C string. */
+class String {
+ public:
+  String(const char* str = "") : m_str(str) {}  // NOLINT
+  const char* c_str() const {return m_str;}
+
+ private:
+  const char* m_str;
+};
+#endif  // Arduino_h
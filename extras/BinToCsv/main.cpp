@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+// Host program to convert ExFatLogger and AvrAdcLogger binary files to CSV.
+// Define USE_IMAGE nonzero to read files from a card image with the library.
+#include <stdlib.h>
+#include <unistd.h>
+#include "BinToCsv.h"
+#ifndef USE_IMAGE
+#define USE_IMAGE 0
+#endif  // USE_IMAGE
+#if USE_IMAGE
+#include "ImageBlockDevice.h"
+#endif  // USE_IMAGE
+//------------------------------------------------------------------------------
+static int usage() {
+  fprintf(stderr,
+    "usage: bintocsv [-a] [-j threads] [-u usec] [-i image] bin csv\n"
+    "  -a  AvrAdcLogger file, default is ExFatLogger\n"
+    "  -j  formatting threads, default is number of CPUs\n"
+    "  -u  LOG_INTERVAL_USEC for ExFatLogger header\n"
+#if USE_IMAGE
+    "  -i  card image or device, bin is a path in the image\n"
+#endif  // USE_IMAGE
+    );
+  return 1;
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  BinToCsv conv;
+  BinToCsv::Format format = BinToCsv::EXFAT_LOGGER;
+  const char* image = nullptr;
+  int c;
+  while ((c = getopt(argc, argv, "aj:u:i:")) != -1) {
+    switch (c) {
+      case 'a':
+        format = BinToCsv::AVR_ADC_LOGGER;
+        break;
+
+      case 'j':
+        conv.setThreadCount(atoi(optarg));
+        break;
+
+      case 'u':
+        conv.setLogIntervalUsec(strtoul(optarg, nullptr, 0));
+        break;
+
+      case 'i':
+        image = optarg;
+        break;
+
+      default:
+        return usage();
+    }
+  }
+  if (argc - optind != 2 || (image && !USE_IMAGE)) {
+    return usage();
+  }
+  const char* binPath = argv[optind];
+  const char* csvPath = argv[optind + 1];
+  FILE* csv = fopen(csvPath, "wb");
+  if (!csv) {
+    perror(csvPath);
+    return 1;
+  }
+  bool ok;
+#if USE_IMAGE
+  if (image) {
+    ImageBlockDevice dev;
+    FsVolume vol;
+    FsFile file;
+    if (!dev.open(image) || !vol.begin(&dev)) {
+      fprintf(stderr, "%s: no FAT/exFAT volume\n", image);
+      return 1;
+    }
+    if (!file.open(&vol, binPath, O_RDONLY)) {
+      fprintf(stderr, "%s: not found in image\n", binPath);
+      return 1;
+    }
+    FsFileBinSource src(&file);
+    ok = conv.convert(format, &src, csv);
+  } else  // NOLINT
+#endif  // USE_IMAGE
+  {
+    PosixBinSource src;
+    if (!src.open(binPath)) {
+      perror(binPath);
+      return 1;
+    }
+    ok = conv.convert(format, &src, csv);
+  }
+  if (fclose(csv) != 0) {
+    ok = false;
+  }
+  if (!ok) {
+    fprintf(stderr, "%s\n", conv.errorMsg());
+    return 1;
+  }
+  return 0;
+}
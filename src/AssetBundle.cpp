@@ -0,0 +1,202 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#define DBG_FILE "AssetBundle.cpp"
+#include "common/DebugMacros.h"
+#include "common/FsStructs.h"
+#include "AssetBundle.h"
+// Header layout.
+const uint32_t ASSET_BUNDLE_MAGIC = 0X314E4241;  // "ABN1"
+const uint8_t ASSET_COUNT = 4;
+const uint8_t ASSET_SECTORS = 8;
+const uint8_t ASSET_CHECKSUM = 12;
+const uint8_t ASSET_INDEX = 16;
+const uint8_t ASSET_ENTRY_SIZE = 16;
+//------------------------------------------------------------------------------
+static uint32_t assetHash(const char* name) {
+  // FNV-1a
+  uint32_t h = 2166136261UL;
+  while (*name) {
+    h = (h ^ (uint8_t)*name++)*16777619UL;
+  }
+  return h;
+}
+//------------------------------------------------------------------------------
+static uint32_t assetChecksum(uint32_t sum, const uint8_t* data, size_t n) {
+  while (n--) {
+    sum = ((sum << 1) | (sum >> 31)) + *data++;
+  }
+  return sum;
+}
+//------------------------------------------------------------------------------
+bool AssetBundleBase::begin(BlockDevice* dev, FsBaseFile* file) {
+  uint32_t checksum;
+  uint32_t count;
+  uint32_t sum;
+  uint32_t offset;
+  uint8_t* buf;
+  m_dev = dev;
+  m_count = 0;
+  m_bufSector = NO_SECTOR;
+  if (!file->isContiguous() && !file->contiguousRange(nullptr, nullptr)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_firstSector = file->firstSector();
+  buf = cacheGet(m_firstSector);
+  if (!buf || getLe32(buf) != ASSET_BUNDLE_MAGIC) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  count = getLe32(buf + ASSET_COUNT);
+  m_sectorCount = getLe32(buf + ASSET_SECTORS);
+  checksum = getLe32(buf + ASSET_CHECKSUM);
+  if (count > m_maxCount || m_sectorCount > (file->dataLength() >> 9)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  sum = assetChecksum(0, buf, ASSET_CHECKSUM);
+  offset = ASSET_INDEX;
+  for (uint32_t i = 0; i < count; i++, offset += ASSET_ENTRY_SIZE) {
+    buf = cacheGet(m_firstSector + (offset >> 9));
+    if (!buf) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    // Entries are aligned so they never span sectors.
+    const uint8_t* src = buf + (offset & 0X1FF);
+    sum = assetChecksum(sum, src, ASSET_ENTRY_SIZE);
+    m_index[i].hash = getLe32(src);
+    m_index[i].name = getLe32(src + 4);
+    m_index[i].sector = getLe32(src + 8);
+    m_index[i].size = getLe32(src + 12);
+    if (m_index[i].sector > m_sectorCount ||
+        m_index[i].size/512 + (m_index[i].size % 512 != 0) >
+        m_sectorCount - m_index[i].sector ||
+        (m_index[i].name >> 9) >= m_sectorCount) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+  if (sum != checksum) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_count = count;
+  return true;
+
+ fail:
+  m_dev = nullptr;
+  return false;
+}
+//------------------------------------------------------------------------------
+uint8_t* AssetBundleBase::cacheGet(uint32_t sector) {
+  if (m_bufSector != sector) {
+    m_bufSector = NO_SECTOR;
+    if (!m_dev->readSector(sector, m_buf)) {
+      DBG_FAIL_MACRO;
+      return nullptr;
+    }
+    m_bufSector = sector;
+  }
+  return m_buf;
+}
+//------------------------------------------------------------------------------
+bool AssetBundleBase::open(AssetFile* asset, const char* name) {
+  uint32_t hash = assetHash(name);
+  uint16_t lo = 0;
+  uint16_t hi = m_count;
+  asset->m_bundle = nullptr;
+  if (!m_dev) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  // Find first entry with hash not less than name's hash.
+  while (lo < hi) {
+    uint16_t mid = lo + (hi - lo)/2;
+    if (m_index[mid].hash < hash) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  for (; lo < m_count && m_index[lo].hash == hash; lo++) {
+    AssetEntry_t* entry = &m_index[lo];
+    uint8_t* buf = cacheGet(m_firstSector + (entry->name >> 9));
+    if (!buf) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    // Names never span sectors.
+    const char* str = reinterpret_cast<char*>(buf) + (entry->name & 0X1FF);
+    size_t n = 512 - (entry->name & 0X1FF);
+    if (strncmp(str, name, n) == 0 && strlen(name) < n) {
+      asset->m_bundle = this;
+      asset->m_sector = m_firstSector + entry->sector;
+      asset->m_size = entry->size;
+      asset->m_pos = 0;
+      return true;
+    }
+  }
+
+ fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+int AssetBundleBase::read(AssetFile* asset, void* buf, size_t count) {
+  uint8_t* dst = reinterpret_cast<uint8_t*>(buf);
+  size_t n;
+  if (count > asset->available()) {
+    count = asset->available();
+  }
+  for (size_t toRead = count; toRead; toRead -= n) {
+    uint32_t sector = asset->m_sector + (asset->m_pos >> 9);
+    uint16_t offset = asset->m_pos & 0X1FF;
+    if (offset == 0 && toRead >= 512) {
+      size_t ns = toRead >> 9;
+      n = ns << 9;
+      if (!m_dev->readSectors(sector, dst, ns)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+    } else {
+      uint8_t* src = cacheGet(sector);
+      if (!src) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      n = 512 - offset;
+      if (n > toRead) {
+        n = toRead;
+      }
+      memcpy(dst, src + offset, n);
+    }
+    dst += n;
+    asset->m_pos += n;
+  }
+  return count;
+
+ fail:
+  return -1;
+}
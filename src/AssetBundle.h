@@ -0,0 +1,169 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef AssetBundle_h
+#define AssetBundle_h
+/**
+ * \file
+ * \brief Read-only bundle of assets in a contiguous file.
+ */
+#include "common/BlockDevice.h"
+#include "FsLib/FsLib.h"
+/** Index entry for an asset in a bundle. */
+struct AssetEntry_t {
+  /** FNV-1a hash of the asset name. */
+  uint32_t hash;
+  /** Byte offset in bundle of zero terminated name. */
+  uint32_t name;
+  /** First sector of asset data in bundle. */
+  uint32_t sector;
+  /** Size of asset in bytes. */
+  uint32_t size;
+};
+class AssetBundleBase;
+//------------------------------------------------------------------------------
+/**
+ * \class AssetFile
+ * \brief Read-only handle for an asset in an AssetBundle.
+ */
+class AssetFile {
+ public:
+  AssetFile() : m_bundle(nullptr) {}
+  /** \return Number of bytes from position to end of asset. */
+  uint32_t available() const {return m_size - m_pos;}
+  /** Close the asset. */
+  void close() {m_bundle = nullptr;}
+  /** \return true if the asset is open. */
+  bool isOpen() const {return m_bundle;}
+  /** \return Current position in asset. */
+  uint32_t position() const {return m_pos;}
+  /** Read data from the asset.
+   *
+   * \param[out] buf Location for data.
+   * \param[in] count Maximum number of bytes to read.
+   * \return Number of bytes read or -1 for failure.
+   */
+  int read(void* buf, size_t count);
+  /** Set the position in the asset.
+   *
+   * \param[in] pos New position.
+   * \return true for success or false for failure.
+   */
+  bool seekSet(uint32_t pos) {
+    if (!m_bundle || pos > m_size) {
+      return false;
+    }
+    m_pos = pos;
+    return true;
+  }
+  /** \return Size of the asset in bytes. */
+  uint32_t size() const {return m_size;}
+
+ private:
+  friend class AssetBundleBase;
+  AssetBundleBase* m_bundle;
+  uint32_t m_sector;
+  uint32_t m_size;
+  uint32_t m_pos;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class AssetBundleBase
+ * \brief Read-only bundle of assets in a contiguous file.
+ *
+ * The bundle is built on a host with extras/AssetPack.  Sector zero
+ * starts with a header followed by an index of entries sorted by name
+ * hash.  Names follow the index and asset data starts on a sector
+ * boundary.  All fields are little endian.
+ *
+ * offset | size | field
+ * -------|------|------------------------------------------
+ *    0   |   4  | magic "ABN1"
+ *    4   |   4  | number of entries
+ *    8   |   4  | number of sectors in bundle
+ *   12   |   4  | checksum of header and entries
+ *   16   |  16  | entry, see AssetEntry_t
+ *
+ * begin() loads the index into RAM so open() is a binary search plus
+ * one sector read to check the name.  Asset data is read with multiple
+ * sector commands directly from the block device.
+ */
+class AssetBundleBase {
+ public:
+  /** Load the index of a bundle.
+   *
+   * \param[in] dev Block device for the file's volume.
+   * \param[in] file Contiguous bundle file.
+   * \return true for success or false for failure.
+   */
+  bool begin(BlockDevice* dev, FsBaseFile* file);
+  /** \return Number of assets in the bundle. */
+  uint16_t count() const {return m_count;}
+  /** Open an asset.
+   *
+   * \param[out] asset Handle for the asset.
+   * \param[in] name Name of the asset.
+   * \return true for success or false for failure.
+   */
+  bool open(AssetFile* asset, const char* name);
+
+ protected:
+  /** \cond SHOW_PROTECTED */
+  AssetBundleBase(AssetEntry_t* index, uint16_t maxCount) :
+    m_dev(nullptr), m_index(index), m_maxCount(maxCount), m_count(0) {}
+  /** \endcond */
+
+ private:
+  friend class AssetFile;
+  static const uint32_t NO_SECTOR = 0XFFFFFFFF;
+  uint8_t* cacheGet(uint32_t sector);
+  int read(AssetFile* asset, void* buf, size_t count);
+
+  BlockDevice* m_dev;
+  AssetEntry_t* m_index;
+  uint16_t m_maxCount;
+  uint16_t m_count;
+  uint32_t m_firstSector;
+  uint32_t m_sectorCount;
+  uint32_t m_bufSector;
+  uint8_t m_buf[512];
+};
+//------------------------------------------------------------------------------
+/**
+ * \class AssetBundle
+ * \brief Asset bundle with RAM index for up to \a N assets.
+ */
+template<uint16_t N>
+class AssetBundle : public AssetBundleBase {
+ public:
+  AssetBundle() : AssetBundleBase(m_indexArray, N) {}
+
+ private:
+  AssetEntry_t m_indexArray[N];
+};
+//------------------------------------------------------------------------------
+inline int AssetFile::read(void* buf, size_t count) {
+  return m_bundle ? m_bundle->read(this, buf, count) : -1;
+}
+#endif  // AssetBundle_h
@@ -0,0 +1,243 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BlockPool_h
+#define BlockPool_h
+/**
+ * \file
+ * \brief Pool of sector blocks with empty and full queues.
+ */
+#include "Arduino.h"
+#ifndef __AVR__
+#include <atomic>
+#endif  // __AVR__
+/**
+ * \class BlockPool
+ * \brief Pool of \a N blocks with lock-free empty and full queues.
+ *
+ * An ISR takes a block with getEmpty(), fills it and returns it with
+ * putFull().  Non-interrupt code writes full blocks with writeFile() or
+ * writeCard(), which return the blocks to the empty queue.  If getEmpty()
+ * returns nullptr the ISR should call overrun() and drop the data.
+ *
+ * Each queue has one producer and one consumer so no locks are needed.
+ * Queue indices are one byte so they are atomic on all processors.
+ * Memory fences order block access with index updates so the producer
+ * and consumer may run on different cores.  AVR has no <atomic> and
+ * uses a compiler barrier which is sufficient on a single core.
+ *
+ * BlockType must be a multiple of 512 bytes.  Blocks are queued in
+ * order so consecutive full blocks are usually adjacent in memory and
+ * writeFile() writes them with one multi-sector write.
+ */
+template<class BlockType, uint8_t N>
+class BlockPool {
+ public:
+  BlockPool() {begin();}
+  /** Put all blocks in the empty queue and clear counters.  Not ISR
+   * callable.
+   */
+  void begin() {
+    for (uint8_t i = 0; i < N; i++) {
+      m_emptyQ[i] = i;
+    }
+    m_emptyHead = N;
+    m_emptyTail = 0;
+    m_fullHead = 0;
+    m_fullTail = 0;
+    m_maxFull = 0;
+    m_overrunCount = 0;
+  }
+  /** \return Number of blocks in the empty queue. */
+  uint8_t emptyCount() const {return count(m_emptyHead, m_emptyTail);}
+  /** \return Number of blocks in the full queue. */
+  uint8_t fullCount() const {return count(m_fullHead, m_fullTail);}
+  /** Take a block from the empty queue.  Called by the producer.
+   *
+   * \return Pointer to the block or nullptr if no block is empty.
+   */
+  BlockType* getEmpty() {
+    uint8_t t = m_emptyTail;
+    if (t == m_emptyHead) {
+      return nullptr;
+    }
+    acquireFence();
+    BlockType* b = &m_block[m_emptyQ[t]];
+    releaseFence();
+    m_emptyTail = advance(t);
+    return b;
+  }
+  /** Take the oldest block from the full queue.  Called by the consumer.
+   *
+   * \return Pointer to the block or nullptr if no block is full.
+   */
+  BlockType* getFull() {
+    uint8_t t = m_fullTail;
+    if (t == m_fullHead) {
+      return nullptr;
+    }
+    uint8_t n = fullCount();
+    if (n > m_maxFull) {
+      m_maxFull = n;
+    }
+    acquireFence();
+    BlockType* b = &m_block[m_fullQ[t]];
+    releaseFence();
+    m_fullTail = advance(t);
+    return b;
+  }
+  /** \return Maximum blocks seen in the full queue by the consumer. */
+  uint8_t maxFullCount() const {return m_maxFull;}
+  /** Count data dropped because no block was empty.  Called by the
+   * producer.
+   */
+  void overrun() {m_overrunCount++;}
+  /** \return Number of overruns.  Not ISR callable. */
+  uint32_t overrunCount() const {
+    noInterrupts();
+    uint32_t n = m_overrunCount;
+    interrupts();
+    return n;
+  }
+  /** Return a block to the empty queue.  Called by the consumer.
+   *
+   * \param[in] block Block from getFull().
+   */
+  void putEmpty(BlockType* block) {
+    uint8_t h = m_emptyHead;
+    m_emptyQ[h] = block - m_block;
+    releaseFence();
+    m_emptyHead = advance(h);
+  }
+  /** Add a filled block to the full queue.  Called by the producer.
+   *
+   * \param[in] block Block from getEmpty().
+   */
+  void putFull(BlockType* block) {
+    uint8_t h = m_fullHead;
+    m_fullQ[h] = block - m_block;
+    releaseFence();
+    m_fullHead = advance(h);
+  }
+  /** Write full blocks to a card with writeData().  Called by the
+   * consumer between the card's writeStart() and writeStop().
+   *
+   * A block that fails is returned to the empty queue, not retried.
+   *
+   * \param[in] card SdSpiCard or other card with writeData().
+   * \param[in] maxBlocks Maximum number of blocks to write.
+   * \return Number of blocks written or -1 for failure.
+   */
+  template<class C>
+  int writeCard(C* card, uint8_t maxBlocks = N) {
+    int n = 0;
+    BlockType* b;
+    while (n < maxBlocks && (b = getFull())) {
+      const uint8_t* src = reinterpret_cast<const uint8_t*>(b);
+      for (size_t i = 0; i < sizeof(BlockType); i += 512) {
+        if (!card->writeData(src + i)) {
+          // The write sequence is broken so drop the block's data.
+          putEmpty(b);
+          return -1;
+        }
+      }
+      putEmpty(b);
+      n++;
+    }
+    return n;
+  }
+  /** Write full blocks to a file.  Blocks adjacent in memory are written
+   * with one call.  Called by the consumer.
+   *
+   * \param[in] file FsBaseFile or other file with write().
+   * \param[in] maxBlocks Maximum number of blocks to write.
+   * \return Number of blocks written or -1 for failure.
+   */
+  template<class F>
+  int writeFile(F* file, uint8_t maxBlocks = N) {
+    int n = 0;
+    while (n < maxBlocks) {
+      uint8_t t = m_fullTail;
+      uint8_t k = 0;
+      uint8_t avail = fullCount();
+      if (avail == 0) {
+        break;
+      }
+      if (avail > m_maxFull) {
+        m_maxFull = avail;
+      }
+      acquireFence();
+      uint8_t first = m_fullQ[t];
+      do {
+        k++;
+        t = advance(t);
+      } while (k < avail && (n + k) < maxBlocks && m_fullQ[t] == first + k);
+      size_t nb = k*sizeof(BlockType);
+      if ((size_t)file->write(&m_block[first], nb) != nb) {
+        return -1;
+      }
+      // Remove from the full queue before the producer can reuse blocks.
+      releaseFence();
+      m_fullTail = t;
+      for (uint8_t i = 0; i < k; i++) {
+        putEmpty(&m_block[first + i]);
+      }
+      n += k;
+    }
+    return n;
+  }
+
+ private:
+  static_assert(N > 0 && N < 255, "BlockPool N must be 1 to 254");
+  static_assert(sizeof(BlockType) % 512 == 0,
+                "BlockPool BlockType must be a multiple of 512 bytes");
+  static uint8_t advance(uint8_t i) {return i < N ? i + 1 : 0;}
+#ifdef __AVR__
+  // Keep the compiler from moving block access across index updates.
+  static void acquireFence() {__asm__ __volatile__("" ::: "memory");}
+  static void releaseFence() {__asm__ __volatile__("" ::: "memory");}
+#else  // __AVR__
+  // Read block data only after the index that published it.
+  static void acquireFence() {
+    std::atomic_thread_fence(std::memory_order_acquire);
+  }
+  // Finish block access before the index update that hands it over.
+  static void releaseFence() {
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+#endif  // __AVR__
+  static uint8_t count(uint8_t head, uint8_t tail) {
+    return head >= tail ? head - tail : N + 1 - tail + head;
+  }
+  BlockType m_block[N];
+  uint8_t m_emptyQ[N + 1];
+  uint8_t m_fullQ[N + 1];
+  volatile uint8_t m_emptyHead;
+  volatile uint8_t m_emptyTail;
+  volatile uint8_t m_fullHead;
+  volatile uint8_t m_fullTail;
+  uint8_t m_maxFull;
+  volatile uint32_t m_overrunCount;
+};
+#endif  // BlockPool_h
@@ -30,6 +30,7 @@
 //------------------------------------------------------------------------------
 bool ExFatFile::close() {
   bool rtn = sync();
+  shareClose();
   m_attributes = FILE_ATTR_CLOSED;
   m_flags = 0;
   return rtn;
@@ -288,6 +289,7 @@ bool ExFatFile::openRootFile(ExFatFile* dir, const ExChar_t* name,
       goto fail;
   }
   modeFlags |= oflag & O_APPEND ? FILE_FLAG_APPEND : 0;
+  modeFlags |= oflag & O_DIRECT ? FILE_FLAG_DIRECT : 0;
   if (name) {
     nameHash = exFatHashName(name, nameLength, 0);
     dir->rewind();
@@ -325,7 +327,7 @@ bool ExFatFile::openRootFile(ExFatFile* dir, const ExChar_t* name,
     }
     switch (buf[0]) {
       case EXFAT_TYPE_FILE:
-        memset(this, 0, sizeof(ExFatFile));
+        memset(static_cast<void*>(this), 0, sizeof(ExFatFile));
         dirFile = reinterpret_cast<DirFile_t*>(buf);
         m_setCount = dirFile->setCount;
         m_attributes = getLe16(dirFile->attributes) & FILE_ATTR_COPY;
@@ -394,6 +396,12 @@ bool ExFatFile::openRootFile(ExFatFile* dir, const ExChar_t* name,
       goto fail;
     }
   }
+  if (isFile()) {
+    shareOpen(false);
+  } else {
+    // Directories are read through the cache.
+    m_flags &= ~FILE_FLAG_DIRECT;
+  }
 
 #if !READ_ONLY
   if (oflag & O_TRUNC) {
@@ -445,7 +453,7 @@ bool ExFatFile::openRootFile(ExFatFile* dir, const ExChar_t* name,
   }
 
   freePos.isContiguous = dir->isContiguous();
-  memset(this, 0, sizeof(ExFatFile));
+  memset(static_cast<void*>(this), 0, sizeof(ExFatFile));
   m_vol = dir->volume();
   m_attributes = FILE_ATTR_FILE;
   m_dirPos = freePos;
@@ -506,6 +514,7 @@ bool ExFatFile::openRootFile(ExFatFile* dir, const ExChar_t* name,
       }
     }
   }
+  shareOpen(false);
   return sync();
 #endif  // READ_ONLY
  fail:
@@ -521,7 +530,7 @@ bool ExFatFile::openRoot(ExFatVolume* vol) {
     DBG_FAIL_MACRO;
     goto fail;
   }
-  memset(this, 0, sizeof(ExFatFile));
+  memset(static_cast<void*>(this), 0, sizeof(ExFatFile));
   m_attributes = FILE_ATTR_ROOT;
   m_vol = vol;
   m_flags = FILE_FLAG_READ;
@@ -595,6 +604,14 @@ int ExFatFile::read(void* buf, size_t count) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  // Direct transfers must start and end on a sector boundary.
+  if ((m_flags & FILE_FLAG_DIRECT) &&
+      ((m_curPosition | count) & m_vol->sectorMask())) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  // Another file may have written past the old end of file.
+  shareRefresh();
   if (isContiguous() || isFile()) {
     if ((m_curPosition + count) > m_validLength) {
       count = toRead = m_validLength - m_curPosition;
@@ -627,8 +644,9 @@ int ExFatFile::read(void* buf, size_t count) {
     }
     sector = m_vol->clusterStartSector(m_curCluster) +
              (clusterOffset >> m_vol->bytesPerSectorShift());
-    if (sectorOffset != 0 || toRead < m_vol->bytesPerSector()
-                          || sector == m_vol->dataCacheSector()) {
+    if (!(m_flags & FILE_FLAG_DIRECT) && (sectorOffset != 0 ||
+        toRead < m_vol->bytesPerSector() ||
+        sector == m_vol->dataCacheSector())) {
       n = m_vol->bytesPerSector() - sectorOffset;
       if (n > toRead) {
         n = toRead;
@@ -644,9 +662,24 @@ int ExFatFile::read(void* buf, size_t count) {
 #if USE_MULTI_SECTOR_IO
     } else if (toRead >= 2*m_vol->bytesPerSector()) {
       uint32_t ns = toRead >> m_vol->bytesPerSectorShift();
-      // Limit reads to current cluster.
       uint32_t maxNs = m_vol->sectorsPerCluster()
                        - (clusterOffset >> m_vol->bytesPerSectorShift());
+      // Extend the read over physically contiguous clusters.
+      while (maxNs < ns) {
+        uint32_t next = m_curCluster + 1;
+        if (!isContiguous()) {
+          fg = m_vol->fatGet(m_curCluster, &next);
+          if (fg < 0) {
+            DBG_FAIL_MACRO;
+            goto fail;
+          }
+          if (fg == 0 || next != (m_curCluster + 1)) {
+            break;
+          }
+        }
+        m_curCluster = next;
+        maxNs += m_vol->sectorsPerCluster();
+      }
       if (ns > maxNs) {
         ns = maxNs;
       }
@@ -663,6 +696,10 @@ int ExFatFile::read(void* buf, size_t count) {
         DBG_FAIL_MACRO;
         goto fail;
       }
+      if (n > toRead) {
+        // Direct read of the last sector in the file.
+        n = toRead;
+      }
     }
     dst += n;
     m_curPosition += n;
@@ -686,11 +723,96 @@ bool ExFatFile::remove(const ExChar_t* path) {
  fail:
   return false;
 }
+#if USE_SHARED_FILE_STATE
+//------------------------------------------------------------------------------
+void ExFatFile::shareClose() {
+  if (shareEntry()) {
+    m_vol->m_fileShare.detach(m_shareId);
+  }
+  m_shareId = 0;
+}
+//------------------------------------------------------------------------------
+FsShareEntry_t* ExFatFile::shareEntry() {
+  FsShareEntry_t* e;
+  if (!m_shareId) {
+    return nullptr;
+  }
+  e = m_vol->m_fileShare.entry(m_shareId);
+  if (e->refs == 0 || e->sector != shareSector() ||
+      e->offset != (m_dirPos.position & m_vol->sectorMask())) {
+    // Entry was released and may have been reused.
+    m_shareId = 0;
+    return nullptr;
+  }
+  return e;
+}
+//------------------------------------------------------------------------------
+void ExFatFile::shareOpen(bool truncated) {
+  FsShareEntry_t* e;
+  m_shareId = m_vol->m_fileShare.attach(shareSector(),
+                                        m_dirPos.position & m_vol->sectorMask());
+  e = shareEntry();
+  if (!e) {
+    return;
+  }
+  m_shareTrunc = e->truncCount;
+  if (e->refs == 1 || truncated) {
+    sharePublish(truncated);
+  } else {
+    shareRefresh();
+  }
+}
+//------------------------------------------------------------------------------
+void ExFatFile::sharePublish(bool truncated) {
+  // Directories are not shared.
+  FsShareEntry_t* e = isFile() ? shareEntry() : nullptr;
+  if (!e) {
+    return;
+  }
+  if (truncated) {
+    m_shareTrunc = ++e->truncCount;
+  }
+  e->firstCluster = m_firstCluster;
+  e->size = m_validLength;
+  e->dataLength = m_dataLength;
+  e->flags = m_flags & FILE_FLAG_CONTIGUOUS;
+}
+//------------------------------------------------------------------------------
+void ExFatFile::shareRefresh() {
+  // Directories are not shared.
+  FsShareEntry_t* e = isFile() ? shareEntry() : nullptr;
+  if (!e) {
+    return;
+  }
+  m_firstCluster = e->firstCluster;
+  m_validLength = e->size;
+  m_dataLength = e->dataLength;
+  m_flags = (m_flags & ~FILE_FLAG_CONTIGUOUS) | e->flags;
+  if (m_shareTrunc != e->truncCount) {
+    // Clusters may have been freed, follow the chain again.
+    uint64_t pos = m_curPosition < m_validLength ? m_curPosition
+                                                 : m_validLength;
+    m_shareTrunc = e->truncCount;
+    m_curPosition = 0;
+    m_curCluster = 0;
+    seekSet(pos);
+  }
+}
+//------------------------------------------------------------------------------
+uint32_t ExFatFile::shareSector() {
+  return m_vol->clusterStartSector(m_dirPos.cluster) +
+         ((m_dirPos.position & m_vol->clusterMask()) >>
+          m_vol->bytesPerSectorShift());
+}
+#endif  // USE_SHARED_FILE_STATE
 //------------------------------------------------------------------------------
 bool ExFatFile::seekSet(uint64_t pos) {
   uint32_t nCur;
   uint32_t nNew;
-  uint32_t tmp = m_curCluster;
+  uint32_t tmp;
+  // Size and chain may have been changed by another file.
+  shareRefresh();
+  tmp = m_curCluster;
   // error if file not open
   if (!isOpen()) {
     DBG_FAIL_MACRO;
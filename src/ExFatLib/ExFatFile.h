@@ -346,6 +346,10 @@ class ExFatFile {
    *
    * O_AT_END - Set the initial position at the end of the file.
    *
+   * O_DIRECT - Transfer data between the caller's buffer and the device
+   * without using the volume cache.  The file position and the size of
+   * each read() or write() must be a multiple of the sector size.
+   *
    * O_CREAT - If the file exists, this flag has no effect except as noted
    * under O_EXCL below. Otherwise, the file shall be created
    *
@@ -431,10 +435,16 @@ class ExFatFile {
    * The file will have zero validLength and dataLength
    * will equal the requested length.
    *
+   * If \a erase is true the clusters are erased so later writes do not
+   * wait for the card to erase flash.  Partial allocation units at each
+   * end are not erased.  The erase is advisory, the result does not
+   * depend on erase success.  Ignored if USE_PREALLOCATE_ERASE is zero.
+   *
    * \param[in] length size of allocated space in bytes.
+   * \param[in] erase Erase the allocated clusters.
    * \return true for success or false for failure.
    */
-  bool preAllocate(uint64_t length);
+  bool preAllocate(uint64_t length, bool erase = false);
      /** Print a file's access date and time
    *
    * \param[in] pr Print stream for output.
@@ -747,6 +757,19 @@ class ExFatFile {
                             ExName_t* fname, const ExChar_t** ptr);
   uint32_t curCluster() const {return m_curCluster;}
   ExFatVolume* volume() const {return m_vol;}
+#if USE_SHARED_FILE_STATE
+  FsShareEntry_t* shareEntry();
+  uint32_t shareSector();
+  void shareClose();
+  void shareOpen(bool truncated);
+  void sharePublish(bool truncated);
+  void shareRefresh();
+#else  // USE_SHARED_FILE_STATE
+  void shareClose() {}
+  void shareOpen(bool truncated) {(void)truncated;}
+  void sharePublish(bool truncated) {(void)truncated;}
+  void shareRefresh() {}
+#endif  // USE_SHARED_FILE_STATE
   bool syncDir();
   //----------------------------------------------------------------------------
   static const uint8_t WRITE_ERROR = 0X1;
@@ -777,6 +800,7 @@ class ExFatFile {
   static const uint8_t FILE_FLAG_READ = 0X01;
   static const uint8_t FILE_FLAG_WRITE = 0X02;
   static const uint8_t FILE_FLAG_APPEND = 0X08;
+  static const uint8_t FILE_FLAG_DIRECT = 0X10;
   static const uint8_t FILE_FLAG_CONTIGUOUS  = 0X40;
   static const uint8_t FILE_FLAG_DIR_DIRTY = 0X80;
 
@@ -792,6 +816,10 @@ class ExFatFile {
   uint8_t       m_attributes = FILE_ATTR_CLOSED;
   uint8_t       m_error = 0;
   uint8_t       m_flags = 0;
+#if USE_SHARED_FILE_STATE
+  FsShareId     m_shareId;
+  uint8_t       m_shareTrunc;
+#endif  // USE_SHARED_FILE_STATE
 };
 
 #include "../common/ArduinoFiles.h"
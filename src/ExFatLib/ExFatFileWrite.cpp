@@ -35,8 +35,9 @@ bool ExFatFile::mkdir(ExFatFile* parent, const ExChar_t* path, bool pFlag) {
   (void)pFlag;
   return false;
 }
-bool ExFatFile::preAllocate(uint64_t length) {
+bool ExFatFile::preAllocate(uint64_t length, bool erase) {
   (void)length;
+  (void)erase;
   return false;
 }
 bool ExFatFile::rename(const ExChar_t* newPath) {
@@ -208,6 +209,8 @@ bool ExFatFile::mkdir(ExFatFile* parent, ExName_t* fname) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  // A directory does not use the file's shared state.
+  shareClose();
   // convert file to directory
 
   m_attributes = FILE_ATTR_SUBDIR;
@@ -228,7 +231,7 @@ bool ExFatFile::mkdir(ExFatFile* parent, ExName_t* fname) {
   return false;
 }
 //------------------------------------------------------------------------------
-bool ExFatFile::preAllocate(uint64_t length) {
+bool ExFatFile::preAllocate(uint64_t length, bool erase) {
   uint32_t find;
   uint32_t need;
   if (!length || !isWritable() || m_firstCluster) {
@@ -248,10 +251,20 @@ bool ExFatFile::preAllocate(uint64_t length) {
   m_dataLength = length;
   m_firstCluster = find;
   m_flags |= FILE_FLAG_DIR_DIRTY | FILE_FLAG_CONTIGUOUS;
+  sharePublish(false);
   if (!sync()) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+#if USE_PREALLOCATE_ERASE
+  if (erase) {
+    // Advisory - the clusters are allocated even if the erase fails.
+    m_vol->eraseSectors(m_vol->clusterStartSector(find),
+                        need << m_vol->sectorsPerClusterShift());
+  }
+#else  // USE_PREALLOCATE_ERASE
+  (void)erase;
+#endif  // USE_PREALLOCATE_ERASE
   return true;
 
  fail:
@@ -265,6 +278,7 @@ bool ExFatFile::remove() {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  shareClose();
   // Free any clusters.
   if (m_firstCluster) {
     if (isContiguous()) {
@@ -273,6 +287,7 @@ bool ExFatFile::remove() {
         DBG_FAIL_MACRO;
         goto fail;
       }
+      m_vol->discardInline();
     } else {
       if (!m_vol->freeChain(m_firstCluster)) {
         DBG_FAIL_MACRO;
@@ -323,10 +338,14 @@ bool ExFatFile::rename(ExFatFile* dirFile, const ExChar_t* newPath) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  // The directory entry will move.
+  shareClose();
   if (!file.open(dirFile, newPath, O_CREAT | O_EXCL | O_WRONLY)) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  // This file replaces file.
+  file.shareClose();
   oldFile = *this;
   m_dirPos = file.m_dirPos;
   m_setCount = file.m_setCount;
@@ -598,6 +617,7 @@ bool ExFatFile::truncate() {
       DBG_FAIL_MACRO;
       goto fail;
     }
+    m_vol->discardInline();
   } else {
     // need to free chain
     if (m_curCluster) {
@@ -627,6 +647,7 @@ bool ExFatFile::truncate() {
   }
   m_dataLength = m_curPosition;
   m_validLength = m_curPosition;
+  sharePublish(true);
   m_flags |= FILE_FLAG_DIR_DIRTY;
   return sync();
 
@@ -658,6 +679,12 @@ size_t ExFatFile::write(const void* buf, size_t nbyte) {
       goto fail;
     }
   }
+  // Direct transfers must start and end on a sector boundary.
+  if ((m_flags & FILE_FLAG_DIRECT) &&
+      ((m_curPosition | nbyte) & m_vol->sectorMask())) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
   while (toWrite) {
     clusterOffset = m_curPosition & m_vol->clusterMask();
     sectorOffset = clusterOffset & m_vol->sectorMask();
@@ -740,9 +767,39 @@ size_t ExFatFile::write(const void* buf, size_t nbyte) {
     } else if (toWrite >= 2*m_vol->bytesPerSector()) {
       // use multiple sector write command
       uint32_t ns = toWrite >> m_vol->bytesPerSectorShift();
-      // Limit writes to current cluster.
       uint32_t maxNs = m_vol->sectorsPerCluster()
                        - (clusterOffset >> m_vol->bytesPerSectorShift());
+      // Extend the write over physically contiguous clusters.
+      while (maxNs < ns) {
+        uint32_t cc = m_curCluster;
+        uint32_t next = cc + 1;
+        int8_t fg;
+        if (isContiguous()) {
+          uint32_t lc = m_firstCluster;
+          lc += (m_dataLength - 1) >> m_vol->bytesPerClusterShift();
+          fg = cc < lc ? 1 : 0;
+        } else {
+          fg = m_vol->fatGet(cc, &next);
+          if (fg < 0) {
+            DBG_FAIL_MACRO;
+            goto fail;
+          }
+        }
+        if (fg == 0) {
+          if (!addCluster()) {
+            DBG_FAIL_MACRO;
+            goto fail;
+          }
+          next = m_curCluster;
+        }
+        if (next != (cc + 1)) {
+          // Not adjacent - a new cluster is linked and written next pass.
+          m_curCluster = cc;
+          break;
+        }
+        m_curCluster = next;
+        maxNs += m_vol->sectorsPerCluster();
+      }
       if (ns > maxNs) {
         ns = maxNs;
       }
@@ -775,6 +832,7 @@ size_t ExFatFile::write(const void* buf, size_t nbyte) {
     // insure sync will update modified date and time
     m_flags |= FILE_FLAG_DIR_DIRTY;
   }
+  sharePublish(false);
   return nbyte;
 
  fail:
@@ -26,9 +26,34 @@
 #include "../common/DebugMacros.h"
 #include "ExFatVolume.h"
 #include "../common/FsStructs.h"
+#if USE_EXFAT_RAM_BITMAP
+//------------------------------------------------------------------------------
+bool ExFatPartition::bitmapBufferSync() {
+  uint32_t first = m_bitmapDirtyFirst;
+  if (m_bitmapBuffer && first < m_bitmapDirtyEnd) {
+    uint8_t* src = m_bitmapBuffer + (first << m_bytesPerSectorShift);
+    if (!m_blockDev->writeSectors(m_clusterHeapStartSector + first, src,
+                                  m_bitmapDirtyEnd - first)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    m_bitmapDirtyFirst = 0XFFFFFFFF;
+    m_bitmapDirtyEnd = 0;
+  }
+  return true;
+
+ fail:
+  return false;
+}
+#endif  // USE_EXFAT_RAM_BITMAP
 //------------------------------------------------------------------------------
 // return 0 if error, 1 if no space, else start cluster.
 uint32_t ExFatPartition::bitmapFind(uint32_t cluster, uint32_t count) {
+  uint32_t found;
+  if (count > 1 && extentFind(count, &found)) {
+    // Best fit indexed extent.
+    return found;
+  }
   uint32_t start = cluster ? cluster - 2 : m_bitmapStart;
   if (start >= m_clusterCount) {
     start = 0;
@@ -58,12 +83,16 @@ uint32_t ExFatPartition::bitmapFind(uint32_t cluster, uint32_t count) {
             return bgnAlloc + 2;
           }
         } else {
+          if ((endAlloc - 1) > bgnAlloc) {
+            extentAdd(bgnAlloc + 2, endAlloc - 1 - bgnAlloc);
+          }
           bgnAlloc = endAlloc;
         }
         if (endAlloc == start) {
           return 1;
         }
         if (endAlloc >= m_clusterCount) {
+          extentAdd(bgnAlloc + 2, endAlloc - bgnAlloc);
           endAlloc = bgnAlloc = 0;
           i = sectorSize;
           break;
@@ -83,20 +112,19 @@ bool ExFatPartition::bitmapModify(uint32_t cluster,
   size_t i;
   uint8_t* cache;
   uint8_t mask;
+  uint32_t n = count;
   cluster -= 2;
   if ((start + count) > m_clusterCount) {
     DBG_FAIL_MACRO;
     goto fail;
   }
-  if (value) {
-    if (start  <= m_bitmapStart && m_bitmapStart < (start + count)) {
-      m_bitmapStart = (start + count) < m_clusterCount ? start + count : 0;
-    }
-  } else {
-    if (start < m_bitmapStart) {
-      m_bitmapStart = start;
-    }
+#if USE_MOUNT_HINTS
+  // The saved free count is correct until the bitmap changes.
+  if (m_hintsOnDisk && !writeHints(FREE_COUNT_UNKNOWN)) {
+    DBG_FAIL_MACRO;
+    goto fail;
   }
+#endif  // USE_MOUNT_HINTS
   mask = 1 << (start & 7);
   sector = m_clusterHeapStartSector +
                    (start >> (m_bytesPerSectorShift + 3));
@@ -115,7 +143,7 @@ bool ExFatPartition::bitmapModify(uint32_t cluster,
         }
         cache[i] ^= mask;
         if (--count == 0) {
-          return true;
+          goto done;
         }
       }
       mask = 1;
@@ -123,6 +151,27 @@ bool ExFatPartition::bitmapModify(uint32_t cluster,
     i = 0;
   }
 
+ done:
+  // Counts change only after every bit has been changed.
+  if (value) {
+    if (start  <= m_bitmapStart && m_bitmapStart < (start + n)) {
+      m_bitmapStart = (start + n) < m_clusterCount ? start + n : 0;
+    }
+    updateFreeClusterCount(-n);
+    freeStepUpdate(start + 2, n, false);
+    discardCancel(start + 2, n);
+    extentRemove(start + 2, n);
+  } else {
+    if (start < m_bitmapStart) {
+      m_bitmapStart = start;
+    }
+    updateFreeClusterCount(n);
+    freeStepUpdate(start + 2, n, true);
+    discardAdd(start + 2, n);
+    extentAdd(start + 2, n);
+  }
+  return true;
+
  fail:
   return false;
 }
@@ -187,6 +236,84 @@ uint8_t ExFatPartition::fatGet(uint32_t cluster, uint32_t* value) {
   *value = next;
   return 1;
 }
+#if USE_CLUSTER_DISCARD
+//------------------------------------------------------------------------------
+bool ExFatPartition::discard() {
+  return cacheSync() && discardPending();
+}
+//------------------------------------------------------------------------------
+void ExFatPartition::discardAdd(uint32_t cluster, uint32_t count) {
+  if (m_discard.policy() == DISCARD_OFF) {
+    return;
+  }
+  uint32_t sector = clusterStartSector(cluster);
+  count <<= m_sectorsPerClusterShift;
+  if (!m_discard.add(sector, count)) {
+    // Queue full - bitmap must be on the device before clusters are erased.
+    discard();
+    m_discard.add(sector, count);
+  }
+}
+//------------------------------------------------------------------------------
+bool ExFatPartition::discardPending() {
+  uint32_t sector;
+  uint32_t count;
+  FsDiscardStats_t* stats = m_discard.stats();
+  while (m_discard.pop(&sector, &count)) {
+    if (!eraseSectors(sector, count)) {
+      stats->failures++;
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    stats->erased++;
+    stats->sectors += count;
+  }
+  return true;
+
+ fail:
+  return false;
+}
+#endif  // USE_CLUSTER_DISCARD
+#if USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+//------------------------------------------------------------------------------
+bool ExFatPartition::eraseSectors(uint32_t sector, uint32_t count) {
+  uint32_t first;
+  uint32_t end = sector + count;
+  uint32_t step;
+  bool rtn = false;
+  if (!m_auSectors) {
+    m_auSectors = m_blockDev->auSectors();
+  }
+  // Only erase whole allocation units, partial units at each end are kept.
+  sector += (m_auSectors - sector % m_auSectors) % m_auSectors;
+  end -= end % m_auSectors;
+  first = sector;
+  // Whole allocation units per command, at most PREALLOCATE_ERASE_SECTORS.
+  step = PREALLOCATE_ERASE_SECTORS - PREALLOCATE_ERASE_SECTORS % m_auSectors;
+  if (!step) {
+    step = m_auSectors;
+  }
+  while (sector < end) {
+    // End each command on a multiple of step.
+    uint32_t n = step - sector % step;
+    if (n > (end - sector)) {
+      n = end - sector;
+    }
+    if (!m_blockDev->erase(sector, sector + n - 1)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    sector += n;
+  }
+  rtn = true;
+
+ fail:
+  if (first < end && (m_dataCache.sector() - first) < (end - first)) {
+    m_dataCache.invalidate();
+  }
+  return rtn;
+}
+#endif  // USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
 //------------------------------------------------------------------------------
 bool ExFatPartition::fatPut(uint32_t cluster, uint32_t value) {
   uint32_t sector;
@@ -209,7 +336,7 @@ bool ExFatPartition::fatPut(uint32_t cluster, uint32_t value) {
 }
 //------------------------------------------------------------------------------
 bool ExFatPartition::freeChain(uint32_t cluster) {
-  uint32_t next;
+  uint32_t next = 0;
   uint32_t start = cluster;
   int8_t status;
   do {
@@ -231,7 +358,8 @@ bool ExFatPartition::freeChain(uint32_t cluster) {
     }
     cluster = next;
   } while (status);
-
+  // One discard for the chain with DISCARD_INLINE.
+  discardInline();
   return true;
 
  fail:
@@ -239,45 +367,72 @@ bool ExFatPartition::freeChain(uint32_t cluster) {
 }
 //------------------------------------------------------------------------------
 uint32_t ExFatPartition::freeClusterCount() {
-  uint32_t nc = 0;
-  uint32_t sector = m_clusterHeapStartSector;
-  uint32_t usedCount = 0;
+  uint32_t free;
+  // Finish any count in progress.
+  return freeClusterCountStep(0XFFFFFFFF, &free) == 1 ? free : 0;
+}
+//------------------------------------------------------------------------------
+int8_t ExFatPartition::freeClusterCountStep(uint32_t budget, uint32_t* count) {
+  uint32_t index;
+  uint32_t n;
   uint8_t* cache;
-
-  while (true) {
-    cache = dataCacheGet(sector++, FsCache::CACHE_FOR_READ);
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  if (m_freeClusterCount != FREE_COUNT_UNKNOWN) {
+    m_freeStepCluster = 0;
+    *count = m_freeClusterCount;
+    return 1;
+  }
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
+  if (m_freeStepCluster < 2) {
+    m_freeStepCluster = 2;
+    m_freeStepFree = 0;
+  }
+  for (; budget && (m_freeStepCluster - 2) < m_clusterCount; budget--) {
+    index = m_freeStepCluster - 2;
+    cache = bitmapCacheGet(m_clusterHeapStartSector +
+                           (index >> (m_bytesPerSectorShift + 3)),
+                           FsCache::CACHE_FOR_READ);
     if (!cache) {
-      return 0;
+      DBG_FAIL_MACRO;
+      goto fail;
     }
-    for (size_t i = 0; i < m_bytesPerSector; i++) {
-      if (cache[i] == 0XFF) {
-        usedCount+= 8;
-      } else if (cache[i]) {
-        for (uint8_t mask = 1; mask ; mask <<=1) {
-          if ((mask & cache[i])) {
-            usedCount++;
-          }
-        }
+    n = 8*m_bytesPerSector;
+    if (n > (m_clusterCount - index)) {
+      n = m_clusterCount - index;
+    }
+    m_freeStepCluster += n;
+    for (size_t i = 0; i < n; i += 8) {
+      uint8_t bits = ~cache[i >> 3];
+      if ((n - i) < 8) {
+        bits &= (1 << (n - i)) - 1;
       }
-      nc += 8;
-      if (nc >= m_clusterCount) {
-        return m_clusterCount - usedCount;
+      for (; bits; bits &= bits - 1) {
+        m_freeStepFree++;
       }
     }
   }
+  if ((m_freeStepCluster - 2) < m_clusterCount) {
+    return 0;
+  }
+  m_freeStepCluster = 0;
+  setFreeClusterCount(m_freeStepFree);
+  *count = m_freeStepFree;
+  return 1;
+
+ fail:
+  m_freeStepCluster = 0;
+  return -1;
 }
 //------------------------------------------------------------------------------
 bool ExFatPartition::init(BlockDevice* dev, uint8_t part) {
   uint32_t volStart = 0;
   uint8_t* cache;
   pbs_t* pbs;
-  BpbExFat_t* bpb;
   MbrSector_t* mbr;
   MbrPart_t* mp;
 
   m_fatType = 0;
-  m_blockDev = dev;
-  cacheInit(m_blockDev);
+  cacheInit(dev);
   cache = dataCacheGet(0, FsCache::CACHE_FOR_READ);
   if (part > 4 || !cache) {
     DBG_FAIL_MACRO;
@@ -302,7 +457,36 @@ bool ExFatPartition::init(BlockDevice* dev, uint8_t part) {
     DBG_FAIL_MACRO;
     goto fail;
   }
-  bpb = reinterpret_cast<BpbExFat_t*>(pbs->bpb);
+  // The BPB stays valid in the cache until the next get.
+  return init(dev, volStart, reinterpret_cast<BpbExFat_t*>(pbs->bpb));
+
+ fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool ExFatPartition::init(BlockDevice* dev, uint32_t volStart,
+                          const BpbExFat_t* bpb) {
+  m_fatType = 0;
+  m_blockDev = dev;
+  cacheInit(m_blockDev);
+#if USE_MOUNT_HINTS
+  m_hintsOnDisk = false;
+#endif  // USE_MOUNT_HINTS
+  m_freeStepCluster = 0;
+#if USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+  m_auSectors = 0;
+#endif  // USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+  extentClear();
+#if USE_SHARED_FILE_STATE
+  m_fileShare.clear();
+#endif  // USE_SHARED_FILE_STATE
+#if USE_CLUSTER_DISCARD
+  // Ranges from a previous mount are not valid, the policy is kept.
+  m_discard.clear();
+#endif  // USE_CLUSTER_DISCARD
+#if USE_EXFAT_RAM_BITMAP
+  m_bitmapBuffer = nullptr;
+#endif  // USE_EXFAT_RAM_BITMAP
   if (bpb->bytesPerSectorShift != m_bytesPerSectorShift) {
     DBG_FAIL_MACRO;
     goto fail;
@@ -315,9 +499,16 @@ bool ExFatPartition::init(BlockDevice* dev, uint8_t part) {
   m_sectorsPerClusterShift = bpb->sectorsPerClusterShift;
   m_bytesPerCluster = 1UL << (m_bytesPerSectorShift + m_sectorsPerClusterShift);
   m_clusterMask = m_bytesPerCluster - 1;
-  // Set m_bitmapStart to first free cluster.
+  // The first free cluster is found by the first allocation, not at mount.
   m_bitmapStart = 0;
-  bitmapFind(0, 1);
+  setFreeClusterCount(FREE_COUNT_UNKNOWN);
+#if USE_MOUNT_HINTS
+  m_volumeStartSector = volStart;
+  if (!loadHints(bpb->percentInUse)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+#endif  // USE_MOUNT_HINTS
   m_fatType = FAT_TYPE_EXFAT;
   return true;
 
@@ -329,3 +520,187 @@ uint32_t ExFatPartition::rootLength() {
   uint32_t nc = chainSize(m_rootDirectoryCluster);
   return nc << bytesPerClusterShift();
 }
+#if USE_MOUNT_HINTS
+//------------------------------------------------------------------------------
+// Returns false only for an I/O error.  A missing record is not an error.
+bool ExFatPartition::loadHints(uint8_t percentInUse) {
+  uint32_t sector = m_volumeStartSector + EXFAT_OEM_PARAMETERS_SECTOR;
+  uint8_t* cache = dataCacheGet(sector, FsCache::CACHE_FOR_READ);
+  if (!cache) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  ExFatHint_t* hint = reinterpret_cast<ExFatHint_t*>(cache);
+  for (uint8_t i = 0; i < EXFAT_OEM_PARAMETER_COUNT; i++, hint++) {
+    if (memcmp(hint->guid, EXFAT_HINT_GUID, sizeof(EXFAT_HINT_GUID))) {
+      continue;
+    }
+    uint32_t nextFree = getLe32(hint->nextFree);
+    if (2 <= nextFree && nextFree <= (m_clusterCount + 1)) {
+      m_bitmapStart = nextFree - 2;
+    }
+    uint32_t freeCount = getLe32(hint->freeCount);
+    m_hintsOnDisk = freeCount != FREE_COUNT_UNKNOWN;
+    // Another implementation may have changed percentInUse.
+    if (freeCount <= m_clusterCount && hint->percentInUse == percentInUse) {
+      setFreeClusterCount(freeCount);
+    }
+    break;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+bool ExFatPartition::saveHints() {
+  uint32_t freeCount = FREE_COUNT_UNKNOWN;
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  freeCount = m_freeClusterCount;
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
+  return writeHints(freeCount);
+}
+//------------------------------------------------------------------------------
+// The backup region is written first.  After a crash the main region is
+// either unchanged or has a matching backup.
+bool ExFatPartition::writeHints(uint32_t freeCount) {
+  uint8_t percentInUse = 0XFF;
+  if (freeCount != FREE_COUNT_UNKNOWN) {
+    percentInUse = (100ULL*(m_clusterCount - freeCount))/m_clusterCount;
+  }
+  if (!m_fatType || !cacheSync()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (!writeHintRegion(m_volumeStartSector + EXFAT_BACKUP_BOOT_SECTOR,
+                       freeCount, percentInUse) ||
+      !writeHintRegion(m_volumeStartSector, freeCount, percentInUse)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_hintsOnDisk = freeCount != FREE_COUNT_UNKNOWN;
+  return true;
+
+ fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool ExFatPartition::writeHintRegion(uint32_t start, uint32_t freeCount,
+                                     uint8_t percentInUse) {
+  uint32_t checksum = 0;
+  uint8_t* cache;
+  ExFatHint_t* hint;
+  ExFatHint_t* slot = nullptr;
+  ExFatPbs_t* pbs;
+  cache = dataCacheGet(start + EXFAT_OEM_PARAMETERS_SECTOR,
+                       FsCache::CACHE_FOR_WRITE);
+  if (!cache) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  // Use the SdFat record or the first unused record.
+  hint = reinterpret_cast<ExFatHint_t*>(cache);
+  for (uint8_t i = 0; i < EXFAT_OEM_PARAMETER_COUNT; i++, hint++) {
+    if (!memcmp(hint->guid, EXFAT_HINT_GUID, sizeof(EXFAT_HINT_GUID))) {
+      slot = hint;
+      break;
+    }
+    if (!slot) {
+      uint8_t k = 0;
+      while (k < sizeof(hint->guid) && hint->guid[k] == 0) {
+        k++;
+      }
+      if (k == sizeof(hint->guid)) {
+        slot = hint;
+      }
+    }
+  }
+  if (!slot) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  memset(slot, 0, sizeof(ExFatHint_t));
+  memcpy(slot->guid, EXFAT_HINT_GUID, sizeof(EXFAT_HINT_GUID));
+  setLe32(slot->nextFree, m_bitmapStart + 2);
+  setLe32(slot->freeCount, freeCount);
+  slot->percentInUse = percentInUse;
+
+  // Recompute boot region checksum.
+  for (uint8_t i = 0; i < EXFAT_BOOT_CHECKSUM_SECTOR; i++) {
+    cache = dataCacheGet(start + i, i ? FsCache::CACHE_FOR_READ :
+                                        FsCache::CACHE_FOR_WRITE);
+    if (!cache) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (i == 0) {
+      pbs = reinterpret_cast<ExFatPbs_t*>(cache);
+      pbs->bpb.percentInUse = percentInUse;
+    }
+    for (size_t k = 0; k < m_bytesPerSector; k++) {
+      if (i == 0 && (k == offsetof(ExFatPbs_t, bpb.volumeFlags[0]) ||
+                     k == offsetof(ExFatPbs_t, bpb.volumeFlags[1]) ||
+                     k == offsetof(ExFatPbs_t, bpb.percentInUse))) {
+        continue;
+      }
+      checksum = exFatChecksum(checksum, cache[k]);
+    }
+  }
+  cache = dataCacheGet(start + EXFAT_BOOT_CHECKSUM_SECTOR,
+                       FsCache::CACHE_RESERVE_FOR_WRITE);
+  if (!cache) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  for (size_t k = 0; k < m_bytesPerSector; k += 4) {
+    setLe32(cache + k, checksum);
+  }
+  // Checksum must be on the device before the other region is written.
+  return cacheSync();
+
+ fail:
+  return false;
+}
+#endif  // USE_MOUNT_HINTS
+#if USE_EXFAT_RAM_BITMAP
+//------------------------------------------------------------------------------
+bool ExFatPartition::setBitmapBuffer(uint8_t* buf, size_t size) {
+  uint32_t n = bitmapBufferSize() >> m_bytesPerSectorShift;
+  if (!bitmapBufferSync()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_bitmapBuffer = nullptr;
+  if (!buf) {
+    return true;
+  }
+  if (!m_fatType || size < bitmapBufferSize()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  // Cached bitmap sectors must be on the device before the bitmap is read.
+#if USE_EXFAT_BITMAP_CACHE
+  if (!m_bitmapCache.sync()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_bitmapCache.invalidate();
+#endif  // USE_EXFAT_BITMAP_CACHE
+  if (!m_dataCache.sync()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if ((m_dataCache.sector() - m_clusterHeapStartSector) < n) {
+    m_dataCache.invalidate();
+  }
+  if (!m_blockDev->readSectors(m_clusterHeapStartSector, buf, n)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_bitmapBuffer = buf;
+  m_bitmapSectors = n;
+  m_bitmapDirtyFirst = 0XFFFFFFFF;
+  m_bitmapDirtyEnd = 0;
+  return true;
+
+ fail:
+  return false;
+}
+#endif  // USE_EXFAT_RAM_BITMAP
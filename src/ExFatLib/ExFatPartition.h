@@ -31,6 +31,10 @@
 #include "../common/SysCall.h"
 #include "../common/BlockDevice.h"
 #include "../common/FsCache.h"
+#include "../common/FsDiscard.h"
+#include "../common/FsExtents.h"
+#include "../common/FsFileShare.h"
+#include "../common/FsStructs.h"
 #include "ExFatConfig.h"
 #include "ExFatTypes.h"
 /** Type for exFAT partition */
@@ -75,6 +79,18 @@ class ExFatPartition {
   uint8_t fatType() const {return m_fatType;}
   /** \return the free cluster count. */
   uint32_t freeClusterCount();
+  /** Count free clusters with bounded work per call.
+   *
+   * Each call continues the count from the previous call.  Clusters
+   * allocated or freed between calls are included in the result.
+   *
+   * \param[in] budget Maximum number of bitmap sectors to read in this call.
+   * \param[out] count Count of free clusters if the count is done.
+   *
+   * \return 1 if the count is done, 0 if more calls are required,
+   * or -1 if an error occurs.
+   */
+  int8_t freeClusterCountStep(uint32_t budget, uint32_t* count);
   /** Initialize a exFAT partition.
    * \param[in] dev The blockDevice for the partition.
    * \param[in] part The partition to be used.  Legal values for \a part are
@@ -85,6 +101,16 @@ class ExFatPartition {
    * \return true for success or false for failure.
    */
   bool init(BlockDevice* dev, uint8_t part);
+  /** Initialize an exFAT partition from a BIOS parameter block read by
+   * the caller.  Sectors are only read to load mount hints.
+   *
+   * \param[in] dev The blockDevice for the partition.
+   * \param[in] volStart First sector of the partition.
+   * \param[in] bpb BIOS parameter block from the partition boot sector.
+   *
+   * \return true for success or false for failure.
+   */
+  bool init(BlockDevice* dev, uint32_t volStart, const BpbExFat_t* bpb);
   /**
    * Check for BlockDevice busy.
    *
@@ -95,6 +121,49 @@ class ExFatPartition {
   uint32_t rootDirectoryCluster() const {return m_rootDirectoryCluster;}
   /** \return the root directory length. */
   uint32_t rootLength();
+#if USE_CLUSTER_DISCARD
+  /** Erase freed clusters that are queued for discard.
+   *
+   * \return true for success or false for failure.
+   */
+  bool discard();
+  /** \return Discard counters. */
+  FsDiscardStats_t* discardStats() {return m_discard.stats();}
+  /** \return Discard policy. */
+  uint8_t discardPolicy() const {return m_discard.policy();}
+  /** Set discard policy for freed clusters.
+   *
+   * \param[in] policy DISCARD_OFF, DISCARD_INLINE, DISCARD_AT_SYNC
+   * or DISCARD_IDLE.
+   */
+  void setDiscardPolicy(uint8_t policy) {m_discard.setPolicy(policy);}
+#endif  // USE_CLUSTER_DISCARD
+#if USE_EXFAT_RAM_BITMAP
+  /** \return Size in bytes of a buffer that holds the allocation bitmap. */
+  uint32_t bitmapBufferSize() const {
+    return ((m_clusterCount + 4095) >> 12) << m_bytesPerSectorShift;
+  }
+  /** Hold the allocation bitmap in RAM.  The bitmap is read into \a buf.
+   * Modified bitmap sectors are written when the volume is synced.
+   *
+   * \param[in] buf Buffer for the bitmap or nullptr to stop using a buffer.
+   * \param[in] size Size of \a buf, at least bitmapBufferSize().
+   *
+   * \return true for success or false for failure.
+   */
+  bool setBitmapBuffer(uint8_t* buf, size_t size);
+#endif  // USE_EXFAT_RAM_BITMAP
+#if USE_MOUNT_HINTS
+  /** Save the next free cluster and free cluster count in the OEM
+   * Parameters sector so the next mount can use them.  The backup boot
+   * region is written before the main boot region so one region always
+   * has a valid checksum.  The record is marked stale by the first
+   * allocation or free after mount.  Call before power down.
+   *
+   * \return true for success or false for failure.
+   */
+  bool saveHints();
+#endif  // USE_MOUNT_HINTS
   /** \return the number of sectors in a cluster. */
   uint32_t sectorsPerCluster() const {return 1UL << m_sectorsPerClusterShift;}
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
@@ -122,9 +191,77 @@ class ExFatPartition {
   friend class ExFatFile;
   uint32_t bitmapFind(uint32_t cluster, uint32_t count);
   bool bitmapModify(uint32_t cluster, uint32_t count, bool value);
+#if USE_CLUSTER_DISCARD
+  FsDiscard m_discard;
+  void discardAdd(uint32_t cluster, uint32_t count);
+  void discardCancel(uint32_t cluster, uint32_t count) {
+    m_discard.cancel(clusterStartSector(cluster),
+                     count << m_sectorsPerClusterShift);
+  }
+  void discardInline() {
+    if (m_discard.policy() == DISCARD_INLINE) {
+      discard();
+    }
+  }
+  bool discardPending();
+  void discardSync() {
+    if (m_discard.policy() == DISCARD_AT_SYNC) {
+      discardPending();
+    }
+  }
+#else  // USE_CLUSTER_DISCARD
+  void discardAdd(uint32_t cluster, uint32_t count) {
+    (void)cluster;
+    (void)count;
+  }
+  void discardCancel(uint32_t cluster, uint32_t count) {
+    (void)cluster;
+    (void)count;
+  }
+  void discardInline() {}
+  void discardSync() {}
+#endif  // USE_CLUSTER_DISCARD
+#if USE_FREE_EXTENT_INDEX
+  FsFreeExtents m_freeExtents;
+  void extentAdd(uint32_t cluster, uint32_t count) {
+    m_freeExtents.add(cluster, count);
+  }
+  void extentClear() {
+    m_freeExtents.clear();
+  }
+  bool extentFind(uint32_t count, uint32_t* cluster) {
+    return m_freeExtents.find(count, cluster);
+  }
+  void extentRemove(uint32_t cluster, uint32_t count) {
+    m_freeExtents.remove(cluster, count);
+  }
+#else  // USE_FREE_EXTENT_INDEX
+  void extentAdd(uint32_t cluster, uint32_t count) {
+    (void)cluster;
+    (void)count;
+  }
+  void extentClear() {}
+  bool extentFind(uint32_t count, uint32_t* cluster) {
+    (void)count;
+    (void)cluster;
+    return false;
+  }
+  void extentRemove(uint32_t cluster, uint32_t count) {
+    (void)cluster;
+    (void)count;
+  }
+#endif  // USE_FREE_EXTENT_INDEX
+#if USE_SHARED_FILE_STATE
+  FsFileShare m_fileShare;
+#endif  // USE_SHARED_FILE_STATE
   //----------------------------------------------------------------------------
   // Cache functions.
   uint8_t* bitmapCacheGet(uint32_t sector, uint8_t option) {
+#if USE_EXFAT_RAM_BITMAP
+    if (m_bitmapBuffer) {
+      return bitmapBufferGet(sector, option);
+    }
+#endif  // USE_EXFAT_RAM_BITMAP
 #if USE_EXFAT_BITMAP_CACHE
     return m_bitmapCache.get(sector, option);
 #else  // USE_EXFAT_BITMAP_CACHE
@@ -138,11 +275,21 @@ class ExFatPartition {
     m_dataCache.init(dev);
   }
   bool cacheSync() {
+#if USE_EXFAT_RAM_BITMAP
+    if (!bitmapBufferSync()) {
+      return false;
+    }
+#endif  // USE_EXFAT_RAM_BITMAP
 #if USE_EXFAT_BITMAP_CACHE
-    return m_bitmapCache.sync() && m_dataCache.sync() && syncDevice();
-#else  // USE_EXFAT_BITMAP_CACHE
-    return m_dataCache.sync() && syncDevice();
+    if (!m_bitmapCache.sync()) {
+      return false;
+    }
 #endif  // USE_EXFAT_BITMAP_CACHE
+    if (!m_dataCache.sync() || !syncDevice()) {
+      return false;
+    }
+    discardSync();
+    return true;
   }
   void dataCacheDirty() {m_dataCache.dirty();}
   void dataCacheInvalidate() {m_dataCache.invalidate();}
@@ -159,9 +306,18 @@ class ExFatPartition {
   }
   uint8_t* dirCache(DirPos_t* pos, uint8_t options);
   int8_t dirSeek(DirPos_t* pos, uint32_t offset);
+#if USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+  bool eraseSectors(uint32_t sector, uint32_t count);
+#endif  // USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
   uint8_t fatGet(uint32_t cluster, uint32_t* value);
   bool fatPut(uint32_t cluster, uint32_t value);
   uint32_t chainSize(uint32_t cluster);
+#if USE_MOUNT_HINTS
+  bool loadHints(uint8_t percentInUse);
+  bool writeHints(uint32_t freeCount);
+  bool writeHintRegion(uint32_t start, uint32_t freeCount,
+                       uint8_t percentInUse);
+#endif  // USE_MOUNT_HINTS
   bool freeChain(uint32_t cluster);
   uint16_t sectorMask() const {return m_sectorMask;}
   bool syncDevice() {
@@ -185,7 +341,37 @@ class ExFatPartition {
   bool writeSector(uint32_t sector, const uint8_t* src) {
     return m_blockDev->writeSector(sector, src);
   }
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  // Count of free clusters, FREE_COUNT_UNKNOWN if not known.
+  uint32_t m_freeClusterCount;
+  void setFreeClusterCount(uint32_t value) {
+    m_freeClusterCount = value;
+  }
+  void updateFreeClusterCount(int32_t change) {
+    if (m_freeClusterCount != FREE_COUNT_UNKNOWN) {
+      m_freeClusterCount += change;
+    }
+  }
+#else  // MAINTAIN_FREE_CLUSTER_COUNT
+  void setFreeClusterCount(uint32_t value) {
+    (void)value;
+  }
+  void updateFreeClusterCount(int32_t change) {
+    (void)change;
+  }
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
+  // Adjust a free count in progress for clusters already counted.
+  void freeStepUpdate(uint32_t cluster, uint32_t count, bool free) {
+    if (cluster < m_freeStepCluster) {
+      uint32_t n = m_freeStepCluster - cluster;
+      if (n > count) {
+        n = count;
+      }
+      m_freeStepFree = free ? m_freeStepFree + n : m_freeStepFree - n;
+    }
+  }
   //----------------------------------------------------------------------------
+  static const uint32_t FREE_COUNT_UNKNOWN = 0XFFFFFFFF;
   static const uint8_t  m_bytesPerSectorShift = 9;
   static const uint16_t m_bytesPerSector = 512;
   static const uint16_t m_sectorMask = 0x1FF;
@@ -194,7 +380,38 @@ class ExFatPartition {
   FsCache  m_bitmapCache;
 #endif  // USE_EXFAT_BITMAP_CACHE
   FsCache  m_dataCache;
+#if USE_EXFAT_RAM_BITMAP
+  uint8_t* m_bitmapBuffer = nullptr;
+  uint32_t m_bitmapSectors;       // Size of bitmap in sectors.
+  uint32_t m_bitmapDirtyFirst;    // First dirty sector index.
+  uint32_t m_bitmapDirtyEnd;      // Index after last dirty sector.
+  uint8_t* bitmapBufferGet(uint32_t sector, uint8_t option) {
+    uint32_t i = sector - m_clusterHeapStartSector;
+    if (i >= m_bitmapSectors) {
+      return nullptr;
+    }
+    if (option & FsCache::CACHE_STATUS_DIRTY) {
+      if (i < m_bitmapDirtyFirst) {
+        m_bitmapDirtyFirst = i;
+      }
+      if (i >= m_bitmapDirtyEnd) {
+        m_bitmapDirtyEnd = i + 1;
+      }
+    }
+    return m_bitmapBuffer + (i << m_bytesPerSectorShift);
+  }
+  bool bitmapBufferSync();
+#endif  // USE_EXFAT_RAM_BITMAP
   uint32_t m_bitmapStart;
+#if USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+  uint32_t m_auSectors = 0;        // Erase unit in sectors, zero if unknown.
+#endif  // USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+  uint32_t m_freeStepCluster = 0;  // Next cluster to count, zero if idle.
+  uint32_t m_freeStepFree;         // Free clusters before m_freeStepCluster.
+#if USE_MOUNT_HINTS
+  uint32_t m_volumeStartSector;
+  bool m_hintsOnDisk = false;  // Record has a count that may become stale.
+#endif  // USE_MOUNT_HINTS
   uint32_t m_fatStartSector;
   uint32_t m_fatLength;
   uint32_t m_clusterHeapStartSector;
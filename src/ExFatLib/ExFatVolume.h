@@ -53,6 +53,28 @@ class ExFatVolume : public ExFatPartition {
     }
     return true;
   }
+  /**
+   * Initialize an ExFatVolume object from a BIOS parameter block read by
+   * the caller.
+   * \param[in] dev Device block driver.
+   * \param[in] setCwv Set current working volume if true.
+   * \param[in] volStart First sector of the partition.
+   * \param[in] bpb BIOS parameter block from the partition boot sector.
+   * \return true for success or false for failure.
+   */
+  bool begin(BlockDevice* dev, bool setCwv,
+             uint32_t volStart, const BpbExFat_t* bpb) {
+    if (!init(dev, volStart, bpb)) {
+      return false;
+    }
+    if (!chdir()) {
+      return false;
+    }
+    if (setCwv || !m_cwv) {
+      m_cwv = this;
+    }
+    return true;
+  }
   /**
    * Set volume working directory to root.
    * \return true for success or false for failure.
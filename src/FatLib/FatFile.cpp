@@ -109,6 +109,7 @@ DirFat_t* FatFile::cacheDirEntry(uint8_t action) {
 //------------------------------------------------------------------------------
 bool FatFile::close() {
   bool rtn = sync();
+  shareClose();
   m_attributes = FILE_ATTR_CLOSED;
   m_flags = 0;
   return rtn;
@@ -364,6 +365,8 @@ bool FatFile::mkdir(FatFile* parent, fname_t* fname) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  // A directory does not use the file's shared state.
+  shareClose();
   // convert file to directory
   m_flags = FILE_FLAG_READ;
   m_attributes = FILE_ATTR_SUBDIR;
@@ -419,6 +422,20 @@ bool FatFile::mkdir(FatFile* parent, fname_t* fname) {
   return false;
 }
 //------------------------------------------------------------------------------
+// Get the cluster that follows m_curCluster for data at position.
+// Return 1 for success, 0 at end of chain or -1 for an I/O error.
+int8_t FatFile::nextCluster(uint32_t position, uint32_t* next) {
+#if USE_FAT_FILE_FLAG_CONTIGUOUS
+  if (isFile() && isContiguous() && position < m_fileSize) {
+    *next = m_curCluster + 1;
+    return 1;
+  }
+#else  // USE_FAT_FILE_FLAG_CONTIGUOUS
+  (void)position;
+#endif  // USE_FAT_FILE_FLAG_CONTIGUOUS
+  return m_vol->fatGet(m_curCluster, next);
+}
+//------------------------------------------------------------------------------
 bool FatFile::open(const char* path, oflag_t oflag) {
   return open(FatVolume::cwv(), path, oflag);
 }
@@ -519,7 +536,7 @@ bool FatFile::open(FatFile* dirFile, uint16_t index, oflag_t oflag) {
 bool FatFile::openCachedEntry(FatFile* dirFile, uint16_t dirIndex,
                               oflag_t oflag, uint8_t lfnOrd) {
   uint32_t firstCluster;
-  memset(this, 0, sizeof(FatFile));
+  memset(static_cast<void*>(this), 0, sizeof(FatFile));
   // location of entry in cache
   m_vol = dirFile->m_vol;
   m_dirIndex = dirIndex;
@@ -586,6 +603,10 @@ bool FatFile::openCachedEntry(FatFile* dirFile, uint16_t dirIndex,
     m_firstCluster = firstCluster;
     m_fileSize = getLe32(dir->fileSize);
   }
+  if (isFile()) {
+    m_flags |= (oflag & O_DIRECT ? FILE_FLAG_DIRECT : 0);
+    shareOpen(oflag & O_TRUNC);
+  }
   if ((oflag & O_AT_END) && !seekSet(m_fileSize)) {
     DBG_FAIL_MACRO;
     goto fail;
@@ -657,16 +678,20 @@ bool FatFile::openRoot(FatVolume* vol) {
     DBG_FAIL_MACRO;
     goto fail;
   }
-  memset(this, 0, sizeof(FatFile));
+  memset(static_cast<void*>(this), 0, sizeof(FatFile));
 
   m_vol = vol;
   switch (vol->fatType()) {
 #if FAT12_SUPPORT
   case 12:
 #endif  // FAT12_SUPPORT
+#if FAT16_SUPPORT
   case 16:
+#endif  // FAT16_SUPPORT
+#if FAT_TYPE_DISPATCH
     m_attributes = FILE_ATTR_ROOT_FIXED;
     break;
+#endif  // FAT_TYPE_DISPATCH
 
   case 32:
     m_attributes = FILE_ATTR_ROOT32;
@@ -684,7 +709,7 @@ bool FatFile::openRoot(FatVolume* vol) {
   return false;
 }
 //------------------------------------------------------------------------------
-bool FatFile::preAllocate(uint32_t length) {
+bool FatFile::preAllocate(uint32_t length, bool erase) {
   uint32_t need;
   if (!length || !isWritable() || m_firstCluster) {
     DBG_FAIL_MACRO;
@@ -705,7 +730,21 @@ bool FatFile::preAllocate(uint32_t length) {
   // insure sync() will update dir entry
   m_flags |= FILE_FLAG_DIR_DIRTY;
 #endif  // USE_FAT_FILE_FLAG_CONTIGUOUS
-  return sync();
+  sharePublish(false);
+  if (!sync()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+#if USE_PREALLOCATE_ERASE
+  if (erase) {
+    // Advisory - the clusters are allocated even if the erase fails.
+    m_vol->eraseSectors(m_vol->clusterStartSector(m_firstCluster),
+                        need << m_vol->sectorsPerClusterShift());
+  }
+#else  // USE_PREALLOCATE_ERASE
+  (void)erase;
+#endif  // USE_PREALLOCATE_ERASE
+  return true;
 
  fail:
   return false;
@@ -735,7 +774,15 @@ int FatFile::read(void* buf, size_t nbyte) {
     goto fail;
   }
 
+  // Direct transfers must start and end on a sector boundary.
+  if ((m_flags & FILE_FLAG_DIRECT) &&
+      ((m_curPosition | nbyte) & m_vol->sectorMask())) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
   if (isFile()) {
+    // Another file may have written past the old end of file.
+    shareRefresh();
     uint32_t tmp32 = m_fileSize - m_curPosition;
     if (nbyte >= tmp32) {
       nbyte = tmp32;
@@ -782,8 +829,9 @@ int FatFile::read(void* buf, size_t nbyte) {
       }
       sector = m_vol->clusterStartSector(m_curCluster) + sectorOfCluster;
     }
-    if (offset != 0 || toRead < m_vol->bytesPerSector()
-        || sector == m_vol->cacheSectorNumber()) {
+    if (!(m_flags & FILE_FLAG_DIRECT) && (offset != 0 ||
+        toRead < m_vol->bytesPerSector() ||
+        sector == m_vol->cacheSectorNumber())) {
       // amount to be read from current sector
       n = m_vol->bytesPerSector() - offset;
       if (n > toRead) {
@@ -802,6 +850,21 @@ int FatFile::read(void* buf, size_t nbyte) {
       uint32_t ns = toRead >> m_vol->bytesPerSectorShift();
       if (!isRootFixed()) {
         uint32_t mb = m_vol->sectorsPerCluster() - sectorOfCluster;
+        // Extend the read over physically contiguous clusters.
+        while (mb < ns) {
+          uint32_t next;
+          fg = nextCluster(m_curPosition + (mb << m_vol->bytesPerSectorShift()),
+                           &next);
+          if (fg < 0) {
+            DBG_FAIL_MACRO;
+            goto fail;
+          }
+          if (fg == 0 || next != (m_curCluster + 1)) {
+            break;
+          }
+          m_curCluster = next;
+          mb += m_vol->sectorsPerCluster();
+        }
         if (mb < ns) {
           ns = mb;
         }
@@ -819,6 +882,10 @@ int FatFile::read(void* buf, size_t nbyte) {
         DBG_FAIL_MACRO;
         goto fail;
       }
+      if (n > toRead) {
+        // Direct read of the last sector in the file.
+        n = toRead;
+      }
     }
     dst += n;
     m_curPosition += n;
@@ -911,6 +978,8 @@ bool FatFile::rename(FatFile* dirFile, const char* newPath) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  // The directory entry will move.
+  shareClose();
   // Can't rename LFN in 8.3 mode.
   if (!USE_LONG_FILE_NAMES && isLFN()) {
     DBG_FAIL_MACRO;
@@ -952,6 +1021,8 @@ bool FatFile::rename(FatFile* dirFile, const char* newPath) {
   m_dirIndex = file.m_dirIndex;
   m_lfnOrd = file.m_lfnOrd;
   m_dirCluster = file.m_dirCluster;
+  // This file replaces file.
+  file.shareClose();
   // mark closed to avoid possible destructor close call
   file.m_attributes = FILE_ATTR_CLOSED;
   file.m_flags = 0;
@@ -1049,6 +1120,11 @@ bool FatFile::rmdir() {
 }
 //------------------------------------------------------------------------------
 bool FatFile::rmRfStar() {
+  uint32_t budget = 0XFFFFFFFF;
+  return rmRfStep(&budget) == 1;
+}
+//------------------------------------------------------------------------------
+int8_t FatFile::rmRfStep(uint32_t* budget) {
   uint16_t index;
   FatFile f;
   if (!isDir()) {
@@ -1084,16 +1160,24 @@ bool FatFile::rmRfStar() {
       continue;
     }
 
+    // Entries before this one have been removed.
+    if (*budget == 0) {
+      return 0;
+    }
     if (!f.open(this, index, O_RDONLY)) {
       DBG_FAIL_MACRO;
       goto fail;
     }
     if (f.isSubDir()) {
       // recursively delete
-      if (!f.rmRfStar()) {
+      int8_t rtn = f.rmRfStep(budget);
+      if (rtn < 0) {
         DBG_FAIL_MACRO;
         goto fail;
       }
+      if (rtn == 0) {
+        return 0;
+      }
     } else {
       // ignore read-only
       f.m_flags |= FILE_FLAG_WRITE;
@@ -1101,6 +1185,7 @@ bool FatFile::rmRfStar() {
         DBG_FAIL_MACRO;
         goto fail;
       }
+      (*budget)--;
     }
     // position to next entry if required
     if (m_curPosition != (32UL*(index + 1))) {
@@ -1112,21 +1197,28 @@ bool FatFile::rmRfStar() {
   }
   // don't try to delete root
   if (!isRoot()) {
+    if (*budget == 0) {
+      return 0;
+    }
     if (!rmdir()) {
       DBG_FAIL_MACRO;
       goto fail;
     }
+    (*budget)--;
   }
-  return true;
+  return 1;
 
  fail:
-  return false;
+  return -1;
 }
 //------------------------------------------------------------------------------
 bool FatFile::seekSet(uint32_t pos) {
   uint32_t nCur;
   uint32_t nNew;
-  uint32_t tmp = m_curCluster;
+  uint32_t tmp;
+  // Size and chain may have been changed by another file.
+  shareRefresh();
+  tmp = m_curCluster;
   // error if file not open
   if (!isOpen()) {
     DBG_FAIL_MACRO;
@@ -1187,6 +1279,78 @@ bool FatFile::seekSet(uint32_t pos) {
   m_curCluster = tmp;
   return false;
 }
+#if USE_SHARED_FILE_STATE
+//------------------------------------------------------------------------------
+void FatFile::shareClose() {
+  if (shareEntry()) {
+    m_vol->m_fileShare.detach(m_shareId);
+  }
+  m_shareId = 0;
+}
+//------------------------------------------------------------------------------
+FsShareEntry_t* FatFile::shareEntry() {
+  FsShareEntry_t* e;
+  if (!m_shareId) {
+    return nullptr;
+  }
+  e = m_vol->m_fileShare.entry(m_shareId);
+  if (e->refs == 0 || e->sector != m_dirSector ||
+      e->offset != ((m_dirIndex & 0XF) << 5)) {
+    // Entry was released and may have been reused.
+    m_shareId = 0;
+    return nullptr;
+  }
+  return e;
+}
+//------------------------------------------------------------------------------
+void FatFile::shareOpen(bool truncated) {
+  FsShareEntry_t* e;
+  m_shareId = m_vol->m_fileShare.attach(m_dirSector, (m_dirIndex & 0XF) << 5);
+  e = shareEntry();
+  if (!e) {
+    return;
+  }
+  m_shareTrunc = e->truncCount;
+  if (e->refs == 1 || truncated) {
+    sharePublish(truncated);
+  } else {
+    shareRefresh();
+  }
+}
+//------------------------------------------------------------------------------
+void FatFile::sharePublish(bool truncated) {
+  // Directories are not shared.
+  FsShareEntry_t* e = isFile() ? shareEntry() : nullptr;
+  if (!e) {
+    return;
+  }
+  if (truncated) {
+    m_shareTrunc = ++e->truncCount;
+  }
+  e->firstCluster = m_firstCluster;
+  e->size = m_fileSize;
+  e->flags = m_flags & FILE_FLAG_CONTIGUOUS;
+}
+//------------------------------------------------------------------------------
+void FatFile::shareRefresh() {
+  // Directories are not shared.
+  FsShareEntry_t* e = isFile() ? shareEntry() : nullptr;
+  if (!e) {
+    return;
+  }
+  m_firstCluster = e->firstCluster;
+  m_fileSize = e->size;
+  m_flags = (m_flags & ~FILE_FLAG_CONTIGUOUS) | e->flags;
+  if (m_shareTrunc != e->truncCount) {
+    // Clusters may have been freed, follow the chain again.
+    uint32_t pos = m_curPosition < m_fileSize ? m_curPosition : m_fileSize;
+    m_shareTrunc = e->truncCount;
+    m_curPosition = 0;
+    m_curCluster = 0;
+    seekSet(pos);
+  }
+}
+#endif  // USE_SHARED_FILE_STATE
 //------------------------------------------------------------------------------
 bool FatFile::sync() {
   uint16_t date, time;
@@ -1315,6 +1479,7 @@ bool FatFile::truncate() {
     }
   }
   m_fileSize = m_curPosition;
+  sharePublish(true);
 
   // need to update directory entry
   m_flags |= FILE_FLAG_DIR_DIRTY;
@@ -1349,6 +1514,12 @@ size_t FatFile::write(const void* buf, size_t nbyte) {
       goto fail;
     }
   }
+  // Direct transfers must start and end on a sector boundary.
+  if ((m_flags & FILE_FLAG_DIRECT) &&
+      ((m_curPosition | nbyte) & m_vol->sectorMask())) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
   // Don't exceed max fileSize.
   if (nbyte > (0XFFFFFFFF - m_curPosition)) {
     DBG_FAIL_MACRO;
@@ -1439,6 +1610,32 @@ size_t FatFile::write(const void* buf, size_t nbyte) {
       // use multiple sector write command
       uint32_t maxSectors = m_vol->sectorsPerCluster() - sectorOfCluster;
       uint32_t nSector = nToWrite >> m_vol->bytesPerSectorShift();
+      // Extend the write over physically contiguous clusters.
+      while (maxSectors < nSector) {
+        uint32_t cc = m_curCluster;
+        uint32_t next;
+        int8_t fg = nextCluster(m_curPosition +
+                                (maxSectors << m_vol->bytesPerSectorShift()),
+                                &next);
+        if (fg < 0) {
+          DBG_FAIL_MACRO;
+          goto fail;
+        }
+        if (fg == 0) {
+          if (!addCluster()) {
+            DBG_FAIL_MACRO;
+            goto fail;
+          }
+          next = m_curCluster;
+        }
+        if (next != (cc + 1)) {
+          // Not adjacent - a new cluster is linked and written next pass.
+          m_curCluster = cc;
+          break;
+        }
+        m_curCluster = next;
+        maxSectors += m_vol->sectorsPerCluster();
+      }
       if (nSector > maxSectors) {
         nSector = maxSectors;
       }
@@ -1468,6 +1665,7 @@ size_t FatFile::write(const void* buf, size_t nbyte) {
     // insure sync will update modified date and time
     m_flags |= FILE_FLAG_DIR_DIRTY;
   }
+  sharePublish(false);
   return nbyte;
 
  fail:
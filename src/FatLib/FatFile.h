@@ -483,6 +483,10 @@ class FatFile {
    *
    * O_AT_END - Set the initial position at the end of the file.
    *
+   * O_DIRECT - Transfer data between the caller's buffer and the device
+   * without using the volume cache.  The file position and the size of
+   * each read() or write() must be a multiple of the sector size.
+   *
    * O_CREAT - If the file exists, this flag has no effect except as noted
    * under O_EXCL below. Otherwise, the file shall be created
    *
@@ -541,10 +545,18 @@ class FatFile {
    *
    * The file will contain uninitialized data.
    *
+   * If \a erase is true the clusters are erased so later writes do not
+   * wait for the card to erase flash.  Erased data reads as zero or 0XFF
+   * depending on the card.  See SdSpiCard::dataAfterErase().  Partial
+   * allocation units at each end are not erased.  The erase is advisory,
+   * the result does not depend on erase success.  Ignored if
+   * USE_PREALLOCATE_ERASE is zero.
+   *
    * \param[in] length size of the file in bytes.
+   * \param[in] erase Erase the allocated clusters.
    * \return true for success or false for failure.
    */
-  bool preAllocate(uint32_t length);
+  bool preAllocate(uint32_t length, bool erase = false);
   /** Print a file's access date
    *
    * \param[in] pr Print stream for output.
@@ -780,6 +792,20 @@ class FatFile {
    * \return true for success or false for failure.
    */
   bool rmRfStar();
+  /** Recursively delete a directory and all contained files with bounded
+   * work per call.  See rmRfStar().
+   *
+   * Each call removes at most \a budget files and directories.  Call again
+   * until the directory is removed.
+   *
+   * \param[in] budget Maximum number of files and directories to remove.
+   *
+   * \return 1 if done, 0 if more calls are required, or -1 if an error
+   * occurs.
+   */
+  int8_t rmRfStarStep(uint32_t budget) {
+    return rmRfStep(&budget);
+  }
   /** Set the files position to current position + \a pos. See seekSet().
    * \param[in] offset The new position in bytes from the current position.
    * \return true for success or false for failure.
@@ -957,15 +983,31 @@ class FatFile {
   bool openCluster(FatFile* file);
   static bool parsePathName(const char* str, fname_t* fname, const char** ptr);
   bool mkdir(FatFile* parent, fname_t* fname);
+  int8_t nextCluster(uint32_t position, uint32_t* next);
   bool open(FatFile* dirFile, fname_t* fname, oflag_t oflag);
   bool openCachedEntry(FatFile* dirFile, uint16_t cacheIndex, oflag_t oflag,
                        uint8_t lfnOrd);
   DirFat_t* readDirCache(bool skipReadOk = false);
+  int8_t rmRfStep(uint32_t* budget);
+#if USE_SHARED_FILE_STATE
+  FsShareEntry_t* shareEntry();
+  void shareClose();
+  void shareOpen(bool truncated);
+  void sharePublish(bool truncated);
+  void shareRefresh();
+#else  // USE_SHARED_FILE_STATE
+  void shareClose() {}
+  void shareOpen(bool truncated) {(void)truncated;}
+  void sharePublish(bool truncated) {(void)truncated;}
+  void shareRefresh() {}
+#endif  // USE_SHARED_FILE_STATE
 
   // bits defined in m_flags
   static const uint8_t FILE_FLAG_READ = 0X01;
   static const uint8_t FILE_FLAG_WRITE = 0X02;
   static const uint8_t FILE_FLAG_APPEND = 0X08;
+  // sector aligned transfers bypass the cache
+  static const uint8_t FILE_FLAG_DIRECT = 0X10;
   // treat curPosition as valid length.
   static const uint8_t FILE_FLAG_PREALLOCATE = 0X20;
   // file is contiguous
@@ -981,6 +1023,10 @@ class FatFile {
   uint8_t    m_error = 0;        // Error bits.
   uint8_t    m_flags = 0;        // See above for definition of m_flags bits
   uint8_t    m_lfnOrd;
+#if USE_SHARED_FILE_STATE
+  FsShareId  m_shareId;          // open file table entry, zero if none
+  uint8_t    m_shareTrunc;       // entry truncate count seen by this file
+#endif  // USE_SHARED_FILE_STATE
   uint16_t   m_dirIndex;         // index of directory entry in dir file
   FatVolume* m_vol;              // volume where file is located
   uint32_t   m_dirCluster;
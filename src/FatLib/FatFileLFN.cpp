@@ -175,7 +175,7 @@ bool FatFile::openCluster(FatFile* file) {
   if (file->m_dirCluster == 0) {
     return openRoot(file->m_vol);
   }
-  memset(this, 0, sizeof(FatFile));
+  memset(static_cast<void*>(this), 0, sizeof(FatFile));
   m_attributes = FILE_ATTR_SUBDIR;
   m_flags = FILE_FLAG_READ;
   m_vol = file->m_vol;
@@ -579,6 +579,7 @@ bool FatFile::remove() {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  shareClose();
   // Free any clusters.
   if (m_firstCluster && !m_vol->freeChain(m_firstCluster)) {
     DBG_FAIL_MACRO;
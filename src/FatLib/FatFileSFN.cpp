@@ -280,6 +280,7 @@ bool FatFile::remove() {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  shareClose();
   // Free any clusters.
   if (m_firstCluster && !m_vol->freeChain(m_firstCluster)) {
     DBG_FAIL_MACRO;
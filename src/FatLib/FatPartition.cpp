@@ -31,6 +31,10 @@
 bool FatPartition::allocateCluster(uint32_t current, uint32_t* next) {
   uint32_t find;
   bool setStart;
+  // FAT entries for clusters rangeStart to rangeStart + rangeCount - 1.
+  uint32_t values[m_fatRangeDim];
+  uint32_t rangeStart = 0;
+  uint16_t rangeCount = 0;
   if (m_allocSearchStart < current) {
     // Try to keep file contiguous. Start just after current cluster.
     find = current;
@@ -56,19 +60,24 @@ bool FatPartition::allocateCluster(uint32_t current, uint32_t* next) {
       DBG_FAIL_MACRO;
       goto fail;
     }
-    uint32_t f;
-    int8_t fg = fatGet(find, &f);
-    if (fg < 0) {
-      DBG_FAIL_MACRO;
-      goto fail;
+    if ((find - rangeStart) >= rangeCount) {
+      int16_t rtn = fatGetRange(find, m_fatRangeDim, values);
+      if (rtn <= 0) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      rangeStart = find;
+      rangeCount = rtn;
     }
-    if (fg && f == 0) {
+    if (values[find - rangeStart] == 0) {
       break;
     }
   }
   if (setStart) {
     m_allocSearchStart = find;
   }
+  discardCancel(find, 1);
+  extentRemove(find, 1);
   // Mark end of chain.
   if (!fatPutEOC(find)) {
     DBG_FAIL_MACRO;
@@ -82,6 +91,7 @@ bool FatPartition::allocateCluster(uint32_t current, uint32_t* next) {
     }
   }
   updateFreeClusterCount(-1);
+  freeStepUpdate(find, 1, false);
   *next = find;
   return true;
 
@@ -97,26 +107,41 @@ bool FatPartition::allocContiguous(uint32_t count, uint32_t* firstCluster) {
   uint32_t bgnCluster;
   // end of group
   uint32_t endCluster;
+  // FAT entries for clusters rangeStart to rangeStart + rangeCount - 1.
+  uint32_t values[m_fatRangeDim];
+  uint32_t rangeStart = 0;
+  uint16_t rangeCount = 0;
+  // Use the best fit indexed extent.
+  if (extentFind(count, &bgnCluster)) {
+    endCluster = bgnCluster + count - 1;
+    setStart = false;
+    goto found;
+  }
   // Start at cluster after last allocated cluster.
   endCluster = bgnCluster = m_allocSearchStart + 1;
 
   // search the FAT for free clusters
   while (1) {
     if (endCluster > m_lastCluster) {
+      extentAdd(bgnCluster, endCluster - bgnCluster);
       // Can't find space.
       DBG_FAIL_MACRO;
       goto fail;
     }
-    uint32_t f;
-    int8_t fg = fatGet(endCluster, &f);
-    if (fg < 0) {
-      DBG_FAIL_MACRO;
-      goto fail;
+    if ((endCluster - rangeStart) >= rangeCount) {
+      int16_t rtn = fatGetRange(endCluster, m_fatRangeDim, values);
+      if (rtn <= 0) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      rangeStart = endCluster;
+      rangeCount = rtn;
     }
-    if (f || fg == 0) {
+    if (values[endCluster - rangeStart]) {
       // don't update search start if unallocated clusters before endCluster.
       if (bgnCluster != endCluster) {
         setStart = false;
+        extentAdd(bgnCluster, endCluster - bgnCluster);
       }
       // cluster in use try next cluster as bgnCluster
       bgnCluster = endCluster + 1;
@@ -126,10 +151,14 @@ bool FatPartition::allocContiguous(uint32_t count, uint32_t* firstCluster) {
     }
     endCluster++;
   }
+
+ found:
   // Remember possible next free cluster.
   if (setStart) {
     m_allocSearchStart = endCluster;
   }
+  discardCancel(bgnCluster, count);
+  extentRemove(bgnCluster, count);
   // mark end of chain
   if (!fatPutEOC(endCluster)) {
     DBG_FAIL_MACRO;
@@ -145,6 +174,7 @@ bool FatPartition::allocContiguous(uint32_t count, uint32_t* firstCluster) {
   }
   // Maintain count of free clusters.
   updateFreeClusterCount(-count);
+  freeStepUpdate(bgnCluster, count, false);
 
   // return first cluster number to caller
   *firstCluster = bgnCluster;
@@ -153,19 +183,160 @@ bool FatPartition::allocContiguous(uint32_t count, uint32_t* firstCluster) {
  fail:
   return false;
 }
+#if USE_FAT_GET_RANGE && FAT_TYPE_DISPATCH
+//------------------------------------------------------------------------------
+#if FAT12_SUPPORT
+const FatPartition::FatOps_t FatPartition::m_fat12Ops = {
+  &FatPartition::fatGetRange12, &FatPartition::fatPut12
+};
+#endif  // FAT12_SUPPORT
+#if FAT16_SUPPORT
+const FatPartition::FatOps_t FatPartition::m_fat16Ops = {
+  &FatPartition::fatGetRange16, &FatPartition::fatPut16
+};
+#endif  // FAT16_SUPPORT
+const FatPartition::FatOps_t FatPartition::m_fat32Ops = {
+  &FatPartition::fatGetRange32, &FatPartition::fatPut32
+};
+#endif  // USE_FAT_GET_RANGE && FAT_TYPE_DISPATCH
 //------------------------------------------------------------------------------
 // Fetch a FAT entry - return -1 error, 0 EOC, else 1.
 int8_t FatPartition::fatGet(uint32_t cluster, uint32_t* value) {
-  uint32_t sector;
-  uint32_t next;
-  cache_t* pc;
+  uint32_t next = 0;
+  if (fatGetRange(cluster, 1, &next) != 1) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (isEOC(next)) {
+    return 0;
+  }
+  *value = next;
+  return 1;
 
+ fail:
+  return -1;
+}
+#if USE_FAT_GET_RANGE
+//------------------------------------------------------------------------------
+// Fetch up to count raw FAT entries from the sector holding the first entry.
+// Return the number of entries stored in values or -1 for error.
+int16_t FatPartition::fatGetRange(uint32_t cluster, uint16_t count,
+                                  uint32_t* values) {
   // error if reserved cluster of beyond FAT
-  if (cluster < 2 || cluster > m_lastCluster) {
+  if (cluster < 2 || cluster > m_lastCluster || count == 0) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (count > (m_lastCluster - cluster + 1)) {
+    count = m_lastCluster - cluster + 1;
+  }
+#if FAT_TYPE_DISPATCH
+  return (this->*m_fatOps->getRange)(cluster, count, values);
+#else  // FAT_TYPE_DISPATCH
+  return fatGetRange32(cluster, count, values);
+#endif  // FAT_TYPE_DISPATCH
+
+ fail:
+  return -1;
+}
+#if FAT12_SUPPORT
+//------------------------------------------------------------------------------
+int16_t FatPartition::fatGetRange12(uint32_t cluster, uint16_t count,
+                                    uint32_t* values) {
+  uint16_t n = 0;
+  uint16_t index = cluster;
+  index += index >> 1;
+  uint32_t sector = m_fatStartSector + (index >> m_bytesPerSectorShift);
+  cache_t* pc = cacheFetchFat(sector, FsCache::CACHE_FOR_READ);
+  if (!pc) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  index &= m_sectorMask;
+  while (n < count) {
+    uint16_t tmp = pc->data[index];
+    if (index == m_sectorMask) {
+      // Entry ends in the next sector so it is the last one returned.
+      pc = cacheFetchFat(sector + 1, FsCache::CACHE_FOR_READ);
+      if (!pc) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      tmp |= pc->data[0] << 8;
+      values[n++] = cluster & 1 ? tmp >> 4 : tmp & 0XFFF;
+      break;
+    }
+    tmp |= pc->data[index + 1] << 8;
+    values[n++] = cluster & 1 ? tmp >> 4 : tmp & 0XFFF;
+    // Entries are 1.5 bytes, an odd entry ends on a byte boundary.
+    index += cluster & 1 ? 2 : 1;
+    cluster++;
+    if (index > m_sectorMask) {
+      break;
+    }
+  }
+  return n;
+
+ fail:
+  return -1;
+}
+#endif  // FAT12_SUPPORT
+#if FAT16_SUPPORT
+//------------------------------------------------------------------------------
+int16_t FatPartition::fatGetRange16(uint32_t cluster, uint16_t count,
+                                    uint32_t* values) {
+  uint32_t sector = m_fatStartSector + (cluster >> (m_bytesPerSectorShift - 1));
+  uint16_t index = cluster & (m_sectorMask >> 1);
+  cache_t* pc = cacheFetchFat(sector, FsCache::CACHE_FOR_READ);
+  if (!pc) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (count > (m_bytesPerSector/2 - index)) {
+    count = m_bytesPerSector/2 - index;
+  }
+  for (uint16_t i = 0; i < count; i++) {
+    values[i] = getLe16(reinterpret_cast<uint8_t*>(&pc->fat16[index + i]));
+  }
+  return count;
+
+ fail:
+  return -1;
+}
+#endif  // FAT16_SUPPORT
+//------------------------------------------------------------------------------
+int16_t FatPartition::fatGetRange32(uint32_t cluster, uint16_t count,
+                                    uint32_t* values) {
+  uint32_t sector = m_fatStartSector + (cluster >> (m_bytesPerSectorShift - 2));
+  uint16_t index = cluster & (m_sectorMask >> 2);
+  cache_t* pc = cacheFetchFat(sector, FsCache::CACHE_FOR_READ);
+  if (!pc) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  if (count > (m_bytesPerSector/4 - index)) {
+    count = m_bytesPerSector/4 - index;
+  }
+  for (uint16_t i = 0; i < count; i++) {
+    values[i] = getLe32(reinterpret_cast<uint8_t*>(&pc->fat32[index + i]));
+  }
+  return count;
 
+ fail:
+  return -1;
+}
+#else  // USE_FAT_GET_RANGE
+//------------------------------------------------------------------------------
+// Fetch one raw FAT entry.  Return one or -1 for error.
+int16_t FatPartition::fatGetRange(uint32_t cluster, uint16_t count,
+                                  uint32_t* values) {
+  uint32_t sector;
+  cache_t* pc;
+  // error if reserved cluster of beyond FAT
+  if (cluster < 2 || cluster > m_lastCluster || count == 0) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
   if (fatType() == 32) {
     sector = m_fatStartSector + (cluster >> (m_bytesPerSectorShift - 2));
     pc = cacheFetchFat(sector, FsCache::CACHE_FOR_READ);
@@ -173,18 +344,17 @@ int8_t FatPartition::fatGet(uint32_t cluster, uint32_t* value) {
       DBG_FAIL_MACRO;
       goto fail;
     }
-    next = getLe32(reinterpret_cast<uint8_t*>
-                  (&pc->fat32[cluster & (m_sectorMask >> 2)]));
-  } else if (fatType() == 16) {
-    cluster &= 0XFFFF;
-    sector = m_fatStartSector + (cluster >> (m_bytesPerSectorShift - 1) );
+    *values = getLe32(reinterpret_cast<uint8_t*>
+                     (&pc->fat32[cluster & (m_sectorMask >> 2)]));
+  } else if (FAT16_SUPPORT && fatType() == 16) {
+    sector = m_fatStartSector + (cluster >> (m_bytesPerSectorShift - 1));
     pc = cacheFetchFat(sector, FsCache::CACHE_FOR_READ);
     if (!pc) {
       DBG_FAIL_MACRO;
       goto fail;
     }
-    next = getLe16(reinterpret_cast<uint8_t*>
-                  (&pc->fat16[cluster & (m_sectorMask >> 1)]));
+    *values = getLe16(reinterpret_cast<uint8_t*>
+                     (&pc->fat16[cluster & (m_sectorMask >> 1)]));
   } else if (FAT12_SUPPORT && fatType() == 12) {
     uint16_t index = cluster;
     index += index >> 1;
@@ -206,32 +376,239 @@ int8_t FatPartition::fatGet(uint32_t cluster, uint32_t* value) {
       index = 0;
     }
     tmp |= pc->data[index] << 8;
-    next = cluster & 1 ? tmp >> 4 : tmp & 0XFFF;
+    *values = cluster & 1 ? tmp >> 4 : tmp & 0XFFF;
   } else {
     DBG_FAIL_MACRO;
     goto fail;
   }
-  if (isEOC(next)) {
-    return 0;
-  }
-  *value = next;
   return 1;
 
  fail:
   return -1;
 }
+#endif  // USE_FAT_GET_RANGE
+#if USE_CLUSTER_DISCARD
+//------------------------------------------------------------------------------
+bool FatPartition::discard() {
+  return cacheSync() && discardPending();
+}
+//------------------------------------------------------------------------------
+void FatPartition::discardAdd(uint32_t cluster, uint32_t count) {
+  if (m_discard.policy() == DISCARD_OFF) {
+    return;
+  }
+  uint32_t sector = clusterStartSector(cluster);
+  count <<= m_sectorsPerClusterShift;
+  if (!m_discard.add(sector, count)) {
+    // Queue full - FAT must be on the device before clusters are erased.
+    discard();
+    m_discard.add(sector, count);
+  }
+}
+//------------------------------------------------------------------------------
+bool FatPartition::discardPending() {
+  uint32_t sector;
+  uint32_t count;
+  FsDiscardStats_t* stats = m_discard.stats();
+  while (m_discard.pop(&sector, &count)) {
+    if (!eraseSectors(sector, count)) {
+      stats->failures++;
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    stats->erased++;
+    stats->sectors += count;
+  }
+  return true;
+
+ fail:
+  return false;
+}
+#endif  // USE_CLUSTER_DISCARD
+#if FAT_READ_AHEAD_SECTORS
+//------------------------------------------------------------------------------
+cache_t* FatPartition::fatAheadFetch(FsCache* cache, uint32_t sector,
+                                     uint8_t options) {
+  uint32_t fatEnd = m_fatStartSector + m_sectorsPerFat;
+  uint32_t i = sector - m_fatAheadSector;
+  uint8_t* pc;
+  if (options & FsCache::CACHE_STATUS_DIRTY) {
+    if (m_fatAheadBegin <= i && i < m_fatAheadCount) {
+      // Copies up to this sector may be stale, keep those that follow.
+      m_fatAheadBegin = i + 1;
+    }
+  } else if (!cache->isCached(sector) && sector < fatEnd) {
+    if (i < m_fatAheadBegin || i >= m_fatAheadCount) {
+      uint32_t n = fatEnd - sector;
+      if (n > FAT_READ_AHEAD_SECTORS) {
+        n = FAT_READ_AHEAD_SECTORS;
+      }
+      // Writes a dirty cached sector in the range before the read.
+      m_fatAheadCount = 0;
+      if (!cache->cacheSafeRead(sector, m_fatAhead, n)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      m_fatAheadSector = sector;
+      m_fatAheadBegin = 0;
+      m_fatAheadCount = n;
+      i = 0;
+    }
+    pc = cache->get(sector, options | FsCache::CACHE_OPTION_NO_READ);
+    if (!pc) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    memcpy(pc, m_fatAhead + 512*i, 512);
+    return reinterpret_cast<cache_t*>(pc);
+  }
+  return reinterpret_cast<cache_t*>(cache->get(sector, options));
+
+ fail:
+  return nullptr;
+}
+#endif  // FAT_READ_AHEAD_SECTORS
+#if USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+//------------------------------------------------------------------------------
+bool FatPartition::eraseSectors(uint32_t sector, uint32_t count) {
+  uint32_t first;
+  uint32_t end = sector + count;
+  uint32_t step;
+  bool rtn = false;
+  if (!m_auSectors) {
+    m_auSectors = m_blockDev->auSectors();
+  }
+  // Only erase whole allocation units, partial units at each end are kept.
+  sector += (m_auSectors - sector % m_auSectors) % m_auSectors;
+  end -= end % m_auSectors;
+  first = sector;
+  // Whole allocation units per command, at most PREALLOCATE_ERASE_SECTORS.
+  step = PREALLOCATE_ERASE_SECTORS - PREALLOCATE_ERASE_SECTORS % m_auSectors;
+  if (!step) {
+    step = m_auSectors;
+  }
+  while (sector < end) {
+    // End each command on a multiple of step.
+    uint32_t n = step - sector % step;
+    if (n > (end - sector)) {
+      n = end - sector;
+    }
+    if (!m_blockDev->erase(sector, sector + n - 1)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    sector += n;
+  }
+  rtn = true;
+
+ fail:
+  if (first < end && (m_cache.sector() - first) < (end - first)) {
+    m_cache.invalidate();
+  }
+  return rtn;
+}
+#endif  // USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+#if USE_FAT_GET_RANGE
+//------------------------------------------------------------------------------
+// Store a FAT entry
+bool FatPartition::fatPut(uint32_t cluster, uint32_t value) {
+  // error if reserved cluster of beyond FAT
+  if (cluster < 2 || cluster > m_lastCluster) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+#if FAT_TYPE_DISPATCH
+  return (this->*m_fatOps->put)(cluster, value);
+#else  // FAT_TYPE_DISPATCH
+  return fatPut32(cluster, value);
+#endif  // FAT_TYPE_DISPATCH
+
+ fail:
+  return false;
+}
+#if FAT12_SUPPORT
+//------------------------------------------------------------------------------
+bool FatPartition::fatPut12(uint32_t cluster, uint32_t value) {
+  uint16_t index = cluster;
+  index += index >> 1;
+  uint32_t sector = m_fatStartSector + (index >> m_bytesPerSectorShift);
+  cache_t* pc = cacheFetchFat(sector, FsCache::CACHE_FOR_WRITE);
+  if (!pc) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  index &= m_sectorMask;
+  uint8_t tmp;
+  tmp = value;
+  if (cluster & 1) {
+    tmp = (pc->data[index] & 0XF) | tmp << 4;
+  }
+  pc->data[index] = tmp;
+
+  index++;
+  if (index == m_bytesPerSector) {
+    sector++;
+    index = 0;
+    pc = cacheFetchFat(sector, FsCache::CACHE_FOR_WRITE);
+    if (!pc) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+  tmp = value >> 4;
+  if (!(cluster & 1)) {
+    tmp = ((pc->data[index] & 0XF0)) | tmp >> 4;
+  }
+  pc->data[index] = tmp;
+  return true;
+
+ fail:
+  return false;
+}
+#endif  // FAT12_SUPPORT
+#if FAT16_SUPPORT
+//------------------------------------------------------------------------------
+bool FatPartition::fatPut16(uint32_t cluster, uint32_t value) {
+  uint32_t sector = m_fatStartSector + (cluster >> (m_bytesPerSectorShift - 1));
+  cache_t* pc = cacheFetchFat(sector, FsCache::CACHE_FOR_WRITE);
+  if (!pc) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  setLe16(reinterpret_cast<uint8_t*>
+         (&pc->fat16[cluster & (m_sectorMask >> 1)]), value);
+  return true;
+
+ fail:
+  return false;
+}
+#endif  // FAT16_SUPPORT
+//------------------------------------------------------------------------------
+bool FatPartition::fatPut32(uint32_t cluster, uint32_t value) {
+  uint32_t sector = m_fatStartSector + (cluster >> (m_bytesPerSectorShift - 2));
+  cache_t* pc = cacheFetchFat(sector, FsCache::CACHE_FOR_WRITE);
+  if (!pc) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  setLe32(reinterpret_cast<uint8_t*>
+         (&pc->fat32[cluster & (m_sectorMask >> 2)]), value);
+  return true;
+
+ fail:
+  return false;
+}
+#else  // USE_FAT_GET_RANGE
 //------------------------------------------------------------------------------
 // Store a FAT entry
 bool FatPartition::fatPut(uint32_t cluster, uint32_t value) {
   uint32_t sector;
   cache_t* pc;
-
   // error if reserved cluster of beyond FAT
   if (cluster < 2 || cluster > m_lastCluster) {
     DBG_FAIL_MACRO;
     goto fail;
   }
-
   if (fatType() == 32) {
     sector = m_fatStartSector + (cluster >> (m_bytesPerSectorShift - 2));
     pc = cacheFetchFat(sector, FsCache::CACHE_FOR_WRITE);
@@ -243,10 +620,8 @@ bool FatPartition::fatPut(uint32_t cluster, uint32_t value) {
            (&pc->fat32[cluster & (m_sectorMask >> 2)]), value);
     return true;
   }
-
-  if (fatType() == 16) {
-    cluster &= 0XFFFF;
-    sector = m_fatStartSector + (cluster >> (m_bytesPerSectorShift - 1) );
+  if (FAT16_SUPPORT && fatType() == 16) {
+    sector = m_fatStartSector + (cluster >> (m_bytesPerSectorShift - 1));
     pc = cacheFetchFat(sector, FsCache::CACHE_FOR_WRITE);
     if (!pc) {
       DBG_FAIL_MACRO;
@@ -256,7 +631,6 @@ bool FatPartition::fatPut(uint32_t cluster, uint32_t value) {
            (&pc->fat16[cluster & (m_sectorMask >> 1)]), value);
     return true;
   }
-
   if (FAT12_SUPPORT && fatType() == 12) {
     uint16_t index = cluster;
     index += index >> 1;
@@ -289,18 +663,18 @@ bool FatPartition::fatPut(uint32_t cluster, uint32_t value) {
     }
     pc->data[index] = tmp;
     return true;
-  } else {
-    DBG_FAIL_MACRO;
-    goto fail;
   }
+  DBG_FAIL_MACRO;
 
  fail:
   return false;
 }
+#endif  // USE_FAT_GET_RANGE
 //------------------------------------------------------------------------------
 // free a cluster chain
 bool FatPartition::freeChain(uint32_t cluster) {
-  uint32_t next;
+  uint32_t next = 0;
+  uint32_t start = cluster;
   int8_t fg;
   do {
     fg = fatGet(cluster, &next);
@@ -315,12 +689,19 @@ bool FatPartition::freeChain(uint32_t cluster) {
     }
     // Add one to count of free clusters.
     updateFreeClusterCount(1);
+    freeStepUpdate(cluster, 1, true);
     if (cluster < m_allocSearchStart) {
       m_allocSearchStart = cluster - 1;
     }
+    if (!fg || next != (cluster + 1)) {
+      discardAdd(start, cluster - start + 1);
+      extentAdd(start, cluster - start + 1);
+      start = next;
+    }
     cluster = next;
   } while (fg);
-
+  // One discard for the chain with DISCARD_INLINE.
+  discardInline();
   return true;
 
  fail:
@@ -328,82 +709,119 @@ bool FatPartition::freeChain(uint32_t cluster) {
 }
 //------------------------------------------------------------------------------
 int32_t FatPartition::freeClusterCount() {
+  uint32_t free;
+  // Finish any count in progress.
+  return freeClusterCountStep(0XFFFFFFFF, &free) == 1 ? (int32_t)free : -1;
+}
+//------------------------------------------------------------------------------
+int8_t FatPartition::freeClusterCountStep(uint32_t budget, uint32_t* count) {
+  uint16_t i;
+  uint16_t n;
+  uint32_t sector;
 #if MAINTAIN_FREE_CLUSTER_COUNT
   if (m_freeClusterCount >= 0) {
-    return m_freeClusterCount;
+    m_freeStepCluster = 0;
+    *count = m_freeClusterCount;
+    return 1;
   }
 #endif  // MAINTAIN_FREE_CLUSTER_COUNT
-  uint32_t free = 0;
-  uint32_t sector;
-  uint32_t todo = m_lastCluster + 1;
-  uint16_t n;
-
-  if (FAT12_SUPPORT && fatType() == 12) {
-    for (unsigned i = 2; i < todo; i++) {
-      uint32_t c;
-      int8_t fg = fatGet(i, &c);
-      if (fg < 0) {
+  if (m_freeStepCluster < 2) {
+    m_freeStepCluster = 2;
+    m_freeStepFree = 0;
+  }
+  for (; budget && m_freeStepCluster <= m_lastCluster; budget--) {
+#if FAT12_SUPPORT
+    if (fatType() == 12) {
+      uint32_t values[m_fatRangeDim];
+      // About one sector of 12-bit entries.
+      uint32_t todo = m_lastCluster + 1 - m_freeStepCluster;
+      if (todo > 2*m_bytesPerSector/3) {
+        todo = 2*m_bytesPerSector/3;
+      }
+      while (todo) {
+        int16_t rtn = fatGetRange(m_freeStepCluster,
+                          todo < m_fatRangeDim ? todo : m_fatRangeDim, values);
+        if (rtn <= 0) {
+          DBG_FAIL_MACRO;
+          goto fail;
+        }
+        n = rtn;
+        for (i = 0; i < n; i++) {
+          if (values[i] == 0) {
+            m_freeStepFree++;
+          }
+        }
+        m_freeStepCluster += n;
+        todo -= n;
+      }
+    } else
+#endif  // FAT12_SUPPORT
+#if FAT16_SUPPORT
+    if (fatType() == 16) {
+      sector = m_fatStartSector +
+               (m_freeStepCluster >> (m_bytesPerSectorShift - 1));
+      cache_t* pc = cacheFetchFat(sector, FsCache::CACHE_FOR_READ);
+      if (!pc) {
         DBG_FAIL_MACRO;
         goto fail;
       }
-      if (fg && c == 0) {
-        free++;
+      i = m_freeStepCluster & (m_bytesPerSector/2 - 1);
+      n = m_bytesPerSector/2;
+      if ((m_lastCluster + 1 - m_freeStepCluster) < (uint16_t)(n - i)) {
+        n = i + m_lastCluster + 1 - m_freeStepCluster;
       }
-    }
-  } else if (fatType() == 16 || fatType() == 32) {
-    sector = m_fatStartSector;
-    while (todo) {
-      cache_t* pc = cacheFetchFat(sector++, FsCache::CACHE_FOR_READ);
+      m_freeStepCluster += n - i;
+      for (; i < n; i++) {
+        if (pc->fat16[i] == 0) {
+          m_freeStepFree++;
+        }
+      }
+    } else
+#endif  // FAT16_SUPPORT
+    if (fatType() == 32) {
+      sector = m_fatStartSector +
+               (m_freeStepCluster >> (m_bytesPerSectorShift - 2));
+      cache_t* pc = cacheFetchFat(sector, FsCache::CACHE_FOR_READ);
       if (!pc) {
         DBG_FAIL_MACRO;
         goto fail;
       }
-      n =  fatType() == 16 ? m_bytesPerSector/2 : m_bytesPerSector/4;
-      if (todo < n) {
-        n = todo;
+      i = m_freeStepCluster & (m_bytesPerSector/4 - 1);
+      n = m_bytesPerSector/4;
+      if ((m_lastCluster + 1 - m_freeStepCluster) < (uint16_t)(n - i)) {
+        n = i + m_lastCluster + 1 - m_freeStepCluster;
       }
-      if (fatType() == 16) {
-        for (uint16_t i = 0; i < n; i++) {
-          if (pc->fat16[i] == 0) {
-            free++;
-          }
-        }
-      } else {
-        for (uint16_t i = 0; i < n; i++) {
-          if (pc->fat32[i] == 0) {
-            free++;
-          }
+      m_freeStepCluster += n - i;
+      for (; i < n; i++) {
+        if (pc->fat32[i] == 0) {
+          m_freeStepFree++;
         }
       }
-      todo -= n;
+    } else {
+      // invalid FAT type
+      DBG_FAIL_MACRO;
+      goto fail;
     }
-  } else {
-    // invalid FAT type
-    DBG_FAIL_MACRO;
-    goto fail;
   }
-  setFreeClusterCount(free);
-  return free;
+  if (m_freeStepCluster <= m_lastCluster) {
+    return 0;
+  }
+  m_freeStepCluster = 0;
+  setFreeClusterCount(m_freeStepFree);
+  *count = m_freeStepFree;
+  return 1;
 
  fail:
+  m_freeStepCluster = 0;
   return -1;
 }
 //------------------------------------------------------------------------------
 bool FatPartition::init(BlockDevice* dev, uint8_t part) {
-  uint32_t clusterCount;
-  uint32_t totalSectors;
   uint32_t volumeStartSector = 0;
-  m_blockDev = dev;
   pbs_t* pbs;
-  BpbFat32_t* bpb;
   MbrSector_t* mbr;
-  uint8_t tmp;
   m_fatType = 0;
-  m_allocSearchStart = 1;
   m_cache.init(dev);
-#if USE_SEPARATE_FAT_CACHE
-  m_fatCache.init(dev);
-#endif  // USE_SEPARATE_FAT_CACHE
   // if part == 0 assume super floppy with FAT boot sector in sector zero
   // if part > 0 assume mbr volume with partition table
   if (part) {
@@ -413,9 +831,12 @@ bool FatPartition::init(BlockDevice* dev, uint8_t part) {
     }
     mbr = reinterpret_cast<MbrSector_t*>
           (cacheFetchData(0, FsCache::CACHE_FOR_READ));
+    if (!mbr) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
     MbrPart_t* mp = mbr->part + part - 1;
-
-    if (!mbr || mp->type == 0 || (mp->boot != 0 && mp->boot != 0X80)) {
+    if (mp->type == 0 || (mp->boot != 0 && mp->boot != 0X80)) {
       DBG_FAIL_MACRO;
       goto fail;
     }
@@ -423,8 +844,44 @@ bool FatPartition::init(BlockDevice* dev, uint8_t part) {
   }
   pbs = reinterpret_cast<pbs_t*>
         (cacheFetchData(volumeStartSector, FsCache::CACHE_FOR_READ));
-  bpb = reinterpret_cast<BpbFat32_t*>(pbs->bpb);
-  if (!pbs || bpb->fatCount != 2 || getLe16(bpb->bytesPerSector) != 512) {
+  if (!pbs) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  // The BPB stays valid in the cache until the next fetch.
+  return init(dev, volumeStartSector,
+              reinterpret_cast<BpbFat32_t*>(pbs->bpb));
+
+ fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool FatPartition::init(BlockDevice* dev, uint32_t volumeStartSector,
+                        const BpbFat32_t* bpb) {
+  uint32_t clusterCount;
+  uint32_t totalSectors;
+  uint8_t tmp;
+  m_blockDev = dev;
+  m_fatType = 0;
+  m_allocSearchStart = 1;
+  m_freeStepCluster = 0;
+#if USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+  m_auSectors = 0;
+#endif  // USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+  m_cache.init(dev);
+  fatAheadInvalidate();
+  extentClear();
+#if USE_SHARED_FILE_STATE
+  m_fileShare.clear();
+#endif  // USE_SHARED_FILE_STATE
+#if USE_CLUSTER_DISCARD
+  // Ranges from a previous mount are not valid, the policy is kept.
+  m_discard.clear();
+#endif  // USE_CLUSTER_DISCARD
+#if USE_SEPARATE_FAT_CACHE
+  m_fatCache.init(dev);
+#endif  // USE_SEPARATE_FAT_CACHE
+  if (bpb->fatCount != 2 || getLe16(bpb->bytesPerSector) != 512) {
     DBG_FAIL_MACRO;
     goto fail;
   }
@@ -470,23 +927,98 @@ bool FatPartition::init(BlockDevice* dev, uint8_t part) {
   setFreeClusterCount(-1);
   // FAT type is determined by cluster count
   if (clusterCount < 4085) {
+#if FAT12_SUPPORT
     m_fatType = 12;
-    if (!FAT12_SUPPORT) {
-      DBG_FAIL_MACRO;
-      goto fail;
-    }
+#if USE_FAT_GET_RANGE
+    m_fatOps = &m_fat12Ops;
+#endif  // USE_FAT_GET_RANGE
+#else  // FAT12_SUPPORT
+    DBG_FAIL_MACRO;
+    goto fail;
+#endif  // FAT12_SUPPORT
   } else if (clusterCount < 65525) {
+#if FAT16_SUPPORT
     m_fatType = 16;
+#if USE_FAT_GET_RANGE
+    m_fatOps = &m_fat16Ops;
+#endif  // USE_FAT_GET_RANGE
+#else  // FAT16_SUPPORT
+    DBG_FAIL_MACRO;
+    goto fail;
+#endif  // FAT16_SUPPORT
   } else {
     m_rootDirStart = getLe32(bpb->fat32RootCluster);
     m_fatType = 32;
+#if USE_FAT_GET_RANGE && FAT_TYPE_DISPATCH
+    m_fatOps = &m_fat32Ops;
+#endif  // USE_FAT_GET_RANGE && FAT_TYPE_DISPATCH
+  }
+#if USE_MOUNT_HINTS
+  m_fsInfoSector = 0;
+  if (m_fatType == 32 && getLe16(bpb->fat32FSInfoSector)) {
+    m_fsInfoSector = volumeStartSector + getLe16(bpb->fat32FSInfoSector);
+    FsInfo_t* fsi = reinterpret_cast<FsInfo_t*>
+                    (cacheFetchData(m_fsInfoSector, FsCache::CACHE_FOR_READ));
+    if (!fsi) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (getLe32(fsi->leadSignature) == FSINFO_LEAD_SIGNATURE &&
+        getLe32(fsi->structSignature) == FSINFO_STRUCT_SIGNATURE &&
+        getLe32(fsi->trailSignature) == FSINFO_TRAIL_SIGNATURE) {
+      uint32_t nextFree = getLe32(fsi->nextFree);
+      uint32_t freeCount = getLe32(fsi->freeCount);
+      if (2 <= nextFree && nextFree <= m_lastCluster) {
+        m_allocSearchStart = nextFree - 1;
+      }
+      if (freeCount <= clusterCount) {
+        setFreeClusterCount(freeCount);
+      }
+    } else {
+      m_fsInfoSector = 0;
+    }
   }
+#endif  // USE_MOUNT_HINTS
   m_cache.setMirrorOffset(m_sectorsPerFat);
 #if USE_SEPARATE_FAT_CACHE
   m_fatCache.setMirrorOffset(m_sectorsPerFat);
 #endif  // USE_SEPARATE_FAT_CACHE
   return true;
 
+ fail:
+  // Fail FAT access for an unmounted volume.
+  m_lastCluster = 0;
+  return false;
+}
+#if USE_MOUNT_HINTS
+//------------------------------------------------------------------------------
+bool FatPartition::saveHints() {
+  FsInfo_t* fsi;
+  uint32_t freeCount = 0XFFFFFFFF;
+  if (!m_fatType) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  // Only FAT32 has an FSINFO sector.
+  if (!m_fsInfoSector) {
+    return cacheSync();
+  }
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  if (m_freeClusterCount >= 0) {
+    freeCount = m_freeClusterCount;
+  }
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
+  fsi = reinterpret_cast<FsInfo_t*>
+        (cacheFetchData(m_fsInfoSector, FsCache::CACHE_FOR_WRITE));
+  if (!fsi) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  setLe32(fsi->freeCount, freeCount);
+  setLe32(fsi->nextFree, m_allocSearchStart + 1);
+  return cacheSync();
+
  fail:
   return false;
 }
+#endif  // USE_MOUNT_HINTS
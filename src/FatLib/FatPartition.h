@@ -33,6 +33,9 @@
 #include "../common/SysCall.h"
 #include "../common/BlockDevice.h"
 #include "../common/FsCache.h"
+#include "../common/FsDiscard.h"
+#include "../common/FsExtents.h"
+#include "../common/FsFileShare.h"
 #include "../common/FsStructs.h"
 
 /** Type for FAT12 partition */
@@ -44,6 +47,9 @@ const uint8_t FAT_TYPE_FAT16 = 16;
 /** Type for FAT12 partition */
 const uint8_t FAT_TYPE_FAT32 = 32;
 
+/** Nonzero if FAT access must select the FAT type at mount. */
+#define FAT_TYPE_DISPATCH (FAT12_SUPPORT || FAT16_SUPPORT)
+
 //------------------------------------------------------------------------------
 /**
  * \brief Cache type for a sector.
@@ -136,6 +142,18 @@ class FatPartition {
    * \return Count of free clusters for success or -1 if an error occurs.
    */
   int32_t freeClusterCount();
+  /** Count free clusters with bounded work per call.
+   *
+   * Each call continues the count from the previous call.  Clusters
+   * allocated or freed between calls are included in the result.
+   *
+   * \param[in] budget Maximum number of FAT sectors to read in this call.
+   * \param[out] count Count of free clusters if the count is done.
+   *
+   * \return 1 if the count is done, 0 if more calls are required,
+   * or -1 if an error occurs.
+   */
+  int8_t freeClusterCountStep(uint32_t budget, uint32_t* count);
   /** Initialize a FAT partition.
    *
    * \param[in] dev BlockDevice for this partition.
@@ -147,6 +165,42 @@ class FatPartition {
    * \return true for success or false for failure.
    */
   bool init(BlockDevice* dev, uint8_t part = 1);
+  /** Initialize a FAT partition from a BIOS parameter block read by the
+   * caller.  Sectors are only read to load mount hints.
+   *
+   * \param[in] dev BlockDevice for this partition.
+   * \param[in] volumeStartSector First sector of the partition.
+   * \param[in] bpb BIOS parameter block from the partition boot sector.
+   *
+   * \return true for success or false for failure.
+   */
+  bool init(BlockDevice* dev, uint32_t volumeStartSector,
+            const BpbFat32_t* bpb);
+#if USE_CLUSTER_DISCARD
+  /** Erase freed clusters that are queued for discard.
+   *
+   * \return true for success or false for failure.
+   */
+  bool discard();
+  /** \return Discard counters. */
+  FsDiscardStats_t* discardStats() {return m_discard.stats();}
+  /** \return Discard policy. */
+  uint8_t discardPolicy() const {return m_discard.policy();}
+  /** Set discard policy for freed clusters.
+   *
+   * \param[in] policy DISCARD_OFF, DISCARD_INLINE, DISCARD_AT_SYNC
+   * or DISCARD_IDLE.
+   */
+  void setDiscardPolicy(uint8_t policy) {m_discard.setPolicy(policy);}
+#endif  // USE_CLUSTER_DISCARD
+#if USE_MOUNT_HINTS
+  /** Save the next free cluster and free cluster count in the FAT32 FSINFO
+   * sector so the next mount can use them.  Call before power down.
+   *
+   * \return true for success or false for failure.
+   */
+  bool saveHints();
+#endif  // USE_MOUNT_HINTS
   /** \return The number of entries in the root directory for FAT16 volumes. */
   uint16_t rootDirEntryCount() const {
     return m_rootDirEntryCount;
@@ -190,6 +244,8 @@ class FatPartition {
   static const uint8_t  m_bytesPerSectorShift = 9;
   static const uint16_t m_bytesPerSector = 512;
   static const uint16_t m_sectorMask = 0x1FF;
+  // FAT entries per batched scan.
+  static const uint8_t  m_fatRangeDim = USE_FAT_GET_RANGE ? 8 : 1;
   //----------------------------------------------------------------------------
   BlockDevice* m_blockDev;            // sector device
   uint8_t  m_sectorsPerCluster;       // Cluster size in sectors.
@@ -198,11 +254,19 @@ class FatPartition {
   uint8_t  m_fatType = 0;             // Volume type (12, 16, OR 32).
   uint16_t m_rootDirEntryCount;       // Number of entries in FAT16 root dir.
   uint32_t m_allocSearchStart;        // Start cluster for alloc search.
+#if USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+  uint32_t m_auSectors = 0;           // Erase unit in sectors, zero if unknown.
+#endif  // USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+  uint32_t m_freeStepCluster = 0;     // Next cluster to count, zero if idle.
+  uint32_t m_freeStepFree;            // Free clusters before m_freeStepCluster.
   uint32_t m_sectorsPerFat;           // FAT size in sectors
   uint32_t m_dataStartSector;         // First data sector number.
   uint32_t m_fatStartSector;          // Start sector for first FAT.
-  uint32_t m_lastCluster;             // Last cluster number in FAT.
+  uint32_t m_lastCluster = 0;         // Last cluster number in FAT.
   uint32_t m_rootDirStart;            // Start sector FAT16, cluster FAT32.
+#if USE_MOUNT_HINTS
+  uint32_t m_fsInfoSector;            // FAT32 FSINFO sector, zero if none.
+#endif  // USE_MOUNT_HINTS
   //----------------------------------------------------------------------------
   // sector I/O functions.
   bool cacheSafeRead(uint32_t sector, uint8_t* dst) {
@@ -217,6 +281,9 @@ class FatPartition {
   bool cacheSafeWrite(uint32_t sector, const uint8_t* dst, size_t count) {
     return m_cache.cacheSafeWrite(sector, dst, count);
   }
+#if USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+  bool eraseSectors(uint32_t sector, uint32_t count);
+#endif  // USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
   bool readSector(uint32_t sector, uint8_t* dst) {
     return m_blockDev->readSector(sector, dst);
   }
@@ -244,24 +311,58 @@ class FatPartition {
     (void)change;
   }
 #endif  // MAINTAIN_FREE_CLUSTER_COUNT
+  // Adjust a free count in progress for clusters already counted.
+  void freeStepUpdate(uint32_t cluster, uint32_t count, bool free) {
+    if (cluster < m_freeStepCluster) {
+      uint32_t n = m_freeStepCluster - cluster;
+      if (n > count) {
+        n = count;
+      }
+      m_freeStepFree = free ? m_freeStepFree + n : m_freeStepFree - n;
+    }
+  }
 // sector caches
   FsCache m_cache;
+#if FAT_READ_AHEAD_SECTORS
+  uint32_t m_fatAheadSector;          // Sector for start of m_fatAhead.
+  uint8_t  m_fatAheadBegin = 0;       // Index of first valid sector.
+  uint8_t  m_fatAheadCount = 0;       // Index after last valid sector.
+  uint8_t  m_fatAhead[512*FAT_READ_AHEAD_SECTORS];
+  cache_t* fatAheadFetch(FsCache* cache, uint32_t sector, uint8_t options);
+  void fatAheadInvalidate() {
+    m_fatAheadBegin = 0;
+    m_fatAheadCount = 0;
+  }
+#else  // FAT_READ_AHEAD_SECTORS
+  cache_t* fatAheadFetch(FsCache* cache, uint32_t sector, uint8_t options) {
+    return reinterpret_cast<cache_t*>(cache->get(sector, options));
+  }
+  void fatAheadInvalidate() {}
+#endif  // FAT_READ_AHEAD_SECTORS
 #if USE_SEPARATE_FAT_CACHE
   FsCache m_fatCache;
   cache_t* cacheFetchFat(uint32_t sector, uint8_t options) {
     options |= FsCache::CACHE_STATUS_MIRROR_FAT;
-    return reinterpret_cast<cache_t*>(m_fatCache.get(sector, options));
+    return fatAheadFetch(&m_fatCache, sector, options);
   }
   bool cacheSync() {
-    return m_cache.sync() && m_fatCache.sync() && syncDevice();
+    if (!m_cache.sync() || !m_fatCache.sync() || !syncDevice()) {
+      return false;
+    }
+    discardSync();
+    return true;
   }
 #else  // USE_SEPARATE_FAT_CACHE
   cache_t* cacheFetchFat(uint32_t sector, uint8_t options) {
     options |= FsCache::CACHE_STATUS_MIRROR_FAT;
-    return cacheFetchData(sector, options);
+    return fatAheadFetch(&m_cache, sector, options);
   }
   bool cacheSync() {
-    return m_cache.sync() && syncDevice();
+    if (!m_cache.sync() || !syncDevice()) {
+      return false;
+    }
+    discardSync();
+    return true;
   }
 #endif  // USE_SEPARATE_FAT_CACHE
   cache_t* cacheFetchData(uint32_t sector, uint8_t options) {
@@ -282,6 +383,69 @@ class FatPartition {
   void cacheDirty() {
     m_cache.dirty();
   }
+#if USE_CLUSTER_DISCARD
+  FsDiscard m_discard;
+  void discardAdd(uint32_t cluster, uint32_t count);
+  void discardCancel(uint32_t cluster, uint32_t count) {
+    m_discard.cancel(clusterStartSector(cluster),
+                     count << m_sectorsPerClusterShift);
+  }
+  void discardInline() {
+    if (m_discard.policy() == DISCARD_INLINE) {
+      discard();
+    }
+  }
+  bool discardPending();
+  void discardSync() {
+    if (m_discard.policy() == DISCARD_AT_SYNC) {
+      discardPending();
+    }
+  }
+#else  // USE_CLUSTER_DISCARD
+  void discardAdd(uint32_t cluster, uint32_t count) {
+    (void)cluster;
+    (void)count;
+  }
+  void discardCancel(uint32_t cluster, uint32_t count) {
+    (void)cluster;
+    (void)count;
+  }
+  void discardInline() {}
+  void discardSync() {}
+#endif  // USE_CLUSTER_DISCARD
+#if USE_FREE_EXTENT_INDEX
+  FsFreeExtents m_freeExtents;
+  void extentAdd(uint32_t cluster, uint32_t count) {
+    m_freeExtents.add(cluster, count);
+  }
+  void extentClear() {
+    m_freeExtents.clear();
+  }
+  bool extentFind(uint32_t count, uint32_t* cluster) {
+    return m_freeExtents.find(count, cluster);
+  }
+  void extentRemove(uint32_t cluster, uint32_t count) {
+    m_freeExtents.remove(cluster, count);
+  }
+#else  // USE_FREE_EXTENT_INDEX
+  void extentAdd(uint32_t cluster, uint32_t count) {
+    (void)cluster;
+    (void)count;
+  }
+  void extentClear() {}
+  bool extentFind(uint32_t count, uint32_t* cluster) {
+    (void)count;
+    (void)cluster;
+    return false;
+  }
+  void extentRemove(uint32_t cluster, uint32_t count) {
+    (void)cluster;
+    (void)count;
+  }
+#endif  // USE_FREE_EXTENT_INDEX
+#if USE_SHARED_FILE_STATE
+  FsFileShare m_fileShare;
+#endif  // USE_SHARED_FILE_STATE
   //----------------------------------------------------------------------------
   bool allocateCluster(uint32_t current, uint32_t* next);
   bool allocContiguous(uint32_t count, uint32_t* firstCluster);
@@ -292,7 +456,35 @@ class FatPartition {
     return m_dataStartSector + ((cluster - 2) << m_sectorsPerClusterShift);
   }
   int8_t fatGet(uint32_t cluster, uint32_t* value);
+  int16_t fatGetRange(uint32_t cluster, uint16_t count, uint32_t* values);
   bool fatPut(uint32_t cluster, uint32_t value);
+#if USE_FAT_GET_RANGE
+  int16_t fatGetRange32(uint32_t cluster, uint16_t count, uint32_t* values);
+  bool fatPut32(uint32_t cluster, uint32_t value);
+#if FAT16_SUPPORT
+  int16_t fatGetRange16(uint32_t cluster, uint16_t count, uint32_t* values);
+  bool fatPut16(uint32_t cluster, uint32_t value);
+#endif  // FAT16_SUPPORT
+#if FAT12_SUPPORT
+  int16_t fatGetRange12(uint32_t cluster, uint16_t count, uint32_t* values);
+  bool fatPut12(uint32_t cluster, uint32_t value);
+#endif  // FAT12_SUPPORT
+#if FAT_TYPE_DISPATCH
+  // FAT access functions for one FAT type, selected by init().
+  struct FatOps_t {
+    int16_t (FatPartition::*getRange)(uint32_t, uint16_t, uint32_t*);
+    bool (FatPartition::*put)(uint32_t, uint32_t);
+  };
+#if FAT12_SUPPORT
+  static const FatOps_t m_fat12Ops;
+#endif  // FAT12_SUPPORT
+#if FAT16_SUPPORT
+  static const FatOps_t m_fat16Ops;
+#endif  // FAT16_SUPPORT
+  static const FatOps_t m_fat32Ops;
+  const FatOps_t* m_fatOps = &m_fat32Ops;
+#endif  // FAT_TYPE_DISPATCH
+#endif  // USE_FAT_GET_RANGE
   bool fatPutEOC(uint32_t cluster) {
     return fatPut(cluster, 0x0FFFFFFF);
   }
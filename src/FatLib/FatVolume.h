@@ -56,6 +56,28 @@ class FatVolume : public  FatPartition {
     }
     return true;
   }
+  /**
+   * Initialize an FatVolume object from a BIOS parameter block read by
+   * the caller.
+   * \param[in] dev Device block driver.
+   * \param[in] setCwv Set current working volume if true.
+   * \param[in] volStart First sector of the partition.
+   * \param[in] bpb BIOS parameter block from the partition boot sector.
+   * \return true for success or false for failure.
+   */
+  bool begin(BlockDevice* dev, bool setCwv,
+             uint32_t volStart, const BpbFat32_t* bpb) {
+    if (!init(dev, volStart, bpb)) {
+      return false;
+    }
+    if (!chdir()) {
+      return false;
+    }
+    if (setCwv || !m_cwv) {
+      m_cwv = this;
+    }
+    return true;
+  }
   /** Change global current working volume to this volume. */
   void chvol() {m_cwv = this;}
 
@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#define DBG_FILE "FsAsync.cpp"
+#include "common/DebugMacros.h"
+#include "FsAsync.h"
+#if HAS_FS_ASYNC
+//------------------------------------------------------------------------------
+// Bytes for next step, ending on a sector boundary if possible.
+static size_t stepSize(FsBaseFile* file, size_t n, size_t chunk) {
+  size_t m = chunk - (file->curPosition() & 0X1FF);
+  return n < m ? n : m;
+}
+//------------------------------------------------------------------------------
+void FsAsyncOp::await_suspend(std::coroutine_handle<> h) {
+  m_handle = h;
+  m_exec->add(this);
+}
+//------------------------------------------------------------------------------
+void FsExecutor::add(FsAsyncOp* op) {
+  op->m_next = nullptr;
+  if (m_last) {
+    m_last->m_next = op;
+  } else {
+    m_first = op;
+  }
+  m_last = op;
+}
+//------------------------------------------------------------------------------
+bool FsExecutor::poll() {
+  // Operations added by resumed coroutines wait for the next poll.
+  FsAsyncOp* last = m_last;
+  FsAsyncOp* prev = nullptr;
+  FsAsyncOp* op = m_first;
+  while (op) {
+    bool isLast = op == last;
+    FsAsyncOp* next = op->m_next;
+    if (op->step()) {
+      if (prev) {
+        prev->m_next = next;
+      } else {
+        m_first = next;
+      }
+      if (m_last == op) {
+        m_last = prev;
+      }
+      // The op is in the coroutine frame and may be gone after resume.
+      op->m_handle.resume();
+    } else {
+      prev = op;
+    }
+    if (isLast) {
+      break;
+    }
+    op = next;
+  }
+  return m_first;
+}
+//------------------------------------------------------------------------------
+bool FsReadOp::step() {
+  if (m_dev->isBusy()) {
+    return false;
+  }
+  size_t n = stepSize(m_file, m_count - m_result, m_chunk);
+  int rtn = m_file->read(m_buf + m_result, n);
+  if (rtn < 0) {
+    DBG_FAIL_MACRO;
+    m_result = -1;
+    return true;
+  }
+  m_result += rtn;
+  return rtn == 0 || (size_t)m_result == m_count;
+}
+//------------------------------------------------------------------------------
+bool FsSyncOp::step() {
+  if (m_dev->isBusy()) {
+    return false;
+  }
+  m_result = m_file->sync();
+  return true;
+}
+//------------------------------------------------------------------------------
+bool FsWriteOp::step() {
+  if (m_dev->isBusy()) {
+    return false;
+  }
+  if ((size_t)m_result == m_count) {
+    return true;
+  }
+  size_t n = stepSize(m_file, m_count - m_result, m_chunk);
+  if (m_file->write(m_buf + m_result, n) != n) {
+    DBG_FAIL_MACRO;
+    m_result = -1;
+    return true;
+  }
+  m_result += n;
+  return (size_t)m_result == m_count;
+}
+#endif  // HAS_FS_ASYNC
@@ -0,0 +1,283 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef FsAsync_h
+#define FsAsync_h
+/**
+ * \file
+ * \brief C++20 coroutine awaitables for file operations.
+ */
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+/** Coroutine file operations are available. */
+#define HAS_FS_ASYNC 1
+#else  // __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+/** Coroutine file operations require C++20. */
+#define HAS_FS_ASYNC 0
+#endif  // __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+#if HAS_FS_ASYNC
+#include <coroutine>
+#include <exception>
+#include "common/BlockDevice.h"
+#include "FsLib/FsLib.h"
+class FsExecutor;
+//------------------------------------------------------------------------------
+/**
+ * \class FsTask
+ * \brief Return type for a coroutine that awaits file operations.
+ *
+ * The coroutine runs until its first co_await when called.  It is then
+ * resumed by FsExecutor::poll().  The FsTask must not be destroyed while
+ * the coroutine is waiting for an operation.
+ */
+class FsTask {
+ public:
+  /** \cond SHOW_PROTECTED */
+  struct promise_type {
+    FsTask get_return_object() {
+      return FsTask(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_never initial_suspend() noexcept {return {};}
+    std::suspend_always final_suspend() noexcept {return {};}
+    void return_void() {}
+    void unhandled_exception() {std::terminate();}
+  };
+  /** \endcond */
+  FsTask(const FsTask&) = delete;
+  FsTask& operator=(const FsTask&) = delete;
+  /** Move constructor.
+   * \param[in] task Task to move.
+   */
+  FsTask(FsTask&& task) : m_handle(task.m_handle) {task.m_handle = nullptr;}
+  ~FsTask() {
+    if (m_handle) {
+      m_handle.destroy();
+    }
+  }
+  /** \return true if the coroutine has returned. */
+  bool done() const {return !m_handle || m_handle.done();}
+
+ private:
+  explicit FsTask(std::coroutine_handle<promise_type> h) : m_handle(h) {}
+  std::coroutine_handle<promise_type> m_handle;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class FsAsyncOp
+ * \brief Base for file operation awaitables.
+ *
+ * An operation is split into steps of at most one chunk.  A step is only
+ * started when the block device is not busy so the file functions it
+ * calls do not wait for the card to finish programming.
+ */
+class FsAsyncOp {
+ public:
+  /** \return false, operations always run from the executor. */
+  bool await_ready() const {return false;}
+  /** Queue the operation.
+   * \param[in] h Coroutine to resume when the operation is done.
+   */
+  void await_suspend(std::coroutine_handle<> h);
+  /** \return Result of the operation. */
+  int await_resume() const {return m_result;}
+
+ protected:
+  /** \cond SHOW_PROTECTED */
+  FsAsyncOp(FsExecutor* exec, BlockDevice* dev, FsBaseFile* file) :
+    m_exec(exec), m_dev(dev), m_file(file), m_result(0), m_next(nullptr) {}
+  /** Do one step.
+   * \return true if the operation is done.
+   */
+  virtual bool step() = 0;
+
+  FsExecutor* m_exec;
+  BlockDevice* m_dev;
+  FsBaseFile* m_file;
+  int m_result;
+  /** \endcond */
+
+ private:
+  friend class FsExecutor;
+  FsAsyncOp* m_next;
+  std::coroutine_handle<> m_handle;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class FsExecutor
+ * \brief Single-threaded executor for FsTask coroutines.
+ */
+class FsExecutor {
+ public:
+  FsExecutor() : m_first(nullptr), m_last(nullptr) {}
+  /** \return true if no operations are waiting. */
+  bool empty() const {return !m_first;}
+  /** Do one step of each waiting operation and resume coroutines whose
+   * operation is done.
+   *
+   * \return true if operations are still waiting.
+   */
+  bool poll();
+  /** Call poll() until no operations are waiting. */
+  void run() {
+    while (poll()) {}
+  }
+
+ private:
+  friend class FsAsyncOp;
+  void add(FsAsyncOp* op);
+  FsAsyncOp* m_first;
+  FsAsyncOp* m_last;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class FsReadOp
+ * \brief Awaitable read.  co_await returns bytes read or -1 for failure.
+ */
+class FsReadOp : public FsAsyncOp {
+ public:
+  /** \cond SHOW_PROTECTED */
+  FsReadOp(FsExecutor* exec, BlockDevice* dev, FsBaseFile* file,
+           void* buf, size_t count, size_t chunk) :
+    FsAsyncOp(exec, dev, file), m_buf(reinterpret_cast<uint8_t*>(buf)),
+    m_count(count), m_chunk(chunk) {}
+  /** \endcond */
+
+ protected:
+  /** \cond SHOW_PROTECTED */
+  bool step() override;
+  /** \endcond */
+
+ private:
+  uint8_t* m_buf;
+  size_t m_count;
+  size_t m_chunk;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class FsWriteOp
+ * \brief Awaitable write.  co_await returns bytes written or -1 for failure.
+ */
+class FsWriteOp : public FsAsyncOp {
+ public:
+  /** \cond SHOW_PROTECTED */
+  FsWriteOp(FsExecutor* exec, BlockDevice* dev, FsBaseFile* file,
+            const void* buf, size_t count, size_t chunk) :
+    FsAsyncOp(exec, dev, file), m_buf(reinterpret_cast<const uint8_t*>(buf)),
+    m_count(count), m_chunk(chunk) {}
+  /** \endcond */
+
+ protected:
+  /** \cond SHOW_PROTECTED */
+  bool step() override;
+  /** \endcond */
+
+ private:
+  const uint8_t* m_buf;
+  size_t m_count;
+  size_t m_chunk;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class FsSyncOp
+ * \brief Awaitable sync.  co_await returns one for success or zero for
+ * failure.
+ */
+class FsSyncOp : public FsAsyncOp {
+ public:
+  /** \cond SHOW_PROTECTED */
+  FsSyncOp(FsExecutor* exec, BlockDevice* dev, FsBaseFile* file) :
+    FsAsyncOp(exec, dev, file) {}
+  /** \endcond */
+
+ protected:
+  /** \cond SHOW_PROTECTED */
+  bool step() override;
+  /** \endcond */
+};
+//------------------------------------------------------------------------------
+/**
+ * \class FsAsyncFile
+ * \brief Coroutine interface to an open file.
+ *
+ * The blocking file API is unchanged.  FsAsyncFile calls it in steps of
+ * at most \a chunk bytes, ending on sector boundaries, and suspends the
+ * coroutine while the block device is busy.
+ *
+ * \code
+ * FsTask copy(FsAsyncFile* in, FsAsyncFile* out) {
+ *   static uint8_t buf[4096];
+ *   int n;
+ *   while ((n = co_await in->readAsync(buf, sizeof(buf))) > 0) {
+ *     if (co_await out->writeAsync(buf, n) != n) break;
+ *   }
+ *   co_await out->syncAsync();
+ * }
+ * \endcode
+ */
+class FsAsyncFile {
+ public:
+  /** Constructor.
+   *
+   * \param[in] exec Executor that runs operations.
+   * \param[in] dev Block device for the file's volume.
+   * \param[in] file Open file.
+   * \param[in] chunk Maximum bytes per step, a multiple of 512.
+   */
+  FsAsyncFile(FsExecutor* exec, BlockDevice* dev, FsBaseFile* file,
+              size_t chunk = 512) :
+    m_exec(exec), m_dev(dev), m_file(file), m_chunk(chunk) {}
+  /** \return The file. */
+  FsBaseFile* file() const {return m_file;}
+  /** Read data.
+   *
+   * \param[out] buf Location for data.
+   * \param[in] count Maximum number of bytes to read.
+   * \return Awaitable for bytes read or -1 for failure.
+   */
+  FsReadOp readAsync(void* buf, size_t count) {
+    return FsReadOp(m_exec, m_dev, m_file, buf, count, m_chunk);
+  }
+  /** Save file data and directory entry.
+   * \return Awaitable for true for success or false for failure.
+   */
+  FsSyncOp syncAsync() {
+    return FsSyncOp(m_exec, m_dev, m_file);
+  }
+  /** Write data.
+   *
+   * \param[in] buf Data to write.
+   * \param[in] count Number of bytes to write.
+   * \return Awaitable for bytes written or -1 for failure.
+   */
+  FsWriteOp writeAsync(const void* buf, size_t count) {
+    return FsWriteOp(m_exec, m_dev, m_file, buf, count, m_chunk);
+  }
+
+ private:
+  FsExecutor* m_exec;
+  BlockDevice* m_dev;
+  FsBaseFile* m_file;
+  size_t m_chunk;
+};
+#endif  // HAS_FS_ASYNC
+#endif  // FsAsync_h
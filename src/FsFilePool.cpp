@@ -0,0 +1,235 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#define DBG_FILE "FsFilePool.cpp"
+#include "common/DebugMacros.h"
+#include "FsFilePool.h"
+//------------------------------------------------------------------------------
+// Entry flags are the access mode plus one bit for each flag kept on reopen.
+static const uint8_t ENTRY_APPEND = 0X04;
+static const uint8_t ENTRY_SYNC = 0X08;
+static const uint8_t ENTRY_DIRECT = 0X10;
+//------------------------------------------------------------------------------
+static uint8_t entryFlags(oflag_t oflag) {
+  return (oflag & O_ACCMODE) |
+         (oflag & O_APPEND ? ENTRY_APPEND : 0) |
+         (oflag & O_SYNC ? ENTRY_SYNC : 0) |
+         (oflag & O_DIRECT ? ENTRY_DIRECT : 0);
+}
+//------------------------------------------------------------------------------
+static oflag_t entryOflag(uint8_t flags) {
+  return (flags & O_ACCMODE) |
+         (flags & ENTRY_APPEND ? O_APPEND : 0) |
+         (flags & ENTRY_SYNC ? O_SYNC : 0) |
+         (flags & ENTRY_DIRECT ? O_DIRECT : 0);
+}
+//------------------------------------------------------------------------------
+uint64_t FsPoolFile::curPosition() const {
+  if (!m_pool) {
+    return 0;
+  }
+  FsFilePoolBase::Entry_t* e = &m_pool->m_entry[m_handle];
+  if (e->live != FsFilePoolBase::NO_SLOT) {
+    return m_pool->m_live[e->live].file.curPosition();
+  }
+  return (uint64_t)e->positionHigh << 32 | e->position;
+}
+//------------------------------------------------------------------------------
+bool FsPoolFile::sync() {
+  FsBaseFile* f = file();
+  return f && f->sync();
+}
+//==============================================================================
+FsBaseFile* FsFilePoolBase::acquire(uint16_t handle) {
+  Entry_t* e = &m_entry[handle];
+  uint8_t slot = e->live;
+  if (slot == NO_SLOT) {
+    slot = liveSlot();
+    if (slot == NO_SLOT) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (!m_live[slot].file.open(&m_dir[e->dir].file, e->dirIndex,
+                                 entryOflag(e->flags)) ||
+        !m_live[slot].file.seekSet((uint64_t)e->positionHigh << 32 |
+                                   e->position)) {
+      m_live[slot].file.close();
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    m_live[slot].handle = handle;
+    e->live = slot;
+    m_reopenCount++;
+  }
+  m_live[slot].used = ++m_clock;
+  return &m_live[slot].file;
+
+ fail:
+  return nullptr;
+}
+//------------------------------------------------------------------------------
+void FsFilePoolBase::begin(FsVolume* vol) {
+  m_vol = vol;
+  m_openCount = 0;
+  m_reopenCount = 0;
+  for (uint16_t i = 0; i < m_entryCount; i++) {
+    m_entry[i].dir = NO_SLOT;
+  }
+  for (uint8_t i = 0; i < m_liveCount; i++) {
+    m_live[i].file.close();
+  }
+  for (uint8_t i = 0; i < m_dirCount; i++) {
+    m_dir[i].file.close();
+    m_dir[i].refs = 0;
+  }
+}
+//------------------------------------------------------------------------------
+bool FsFilePoolBase::close(uint16_t handle) {
+  Entry_t* e = &m_entry[handle];
+  bool rtn = true;
+  if (e->live != NO_SLOT) {
+    rtn = m_live[e->live].file.close();
+  }
+  dirRelease(e->dir);
+  e->dir = NO_SLOT;
+  m_openCount--;
+  return rtn;
+}
+//------------------------------------------------------------------------------
+uint8_t FsFilePoolBase::dirOpen(const char* path) {
+  FsBaseFile tmp;
+  uint8_t slot = NO_SLOT;
+  if (!tmp.open(m_vol, path, O_RDONLY) || !tmp.isDir()) {
+    DBG_FAIL_MACRO;
+    return NO_SLOT;
+  }
+  for (uint8_t i = 0; i < m_dirCount; i++) {
+    if (!m_dir[i].refs) {
+      slot = i;
+    } else if (m_dir[i].file.firstSector() == tmp.firstSector()) {
+      m_dir[i].refs++;
+      return i;
+    }
+  }
+  if (slot != NO_SLOT) {
+    m_dir[slot].file = tmp;
+    m_dir[slot].refs = 1;
+  }
+  return slot;
+}
+//------------------------------------------------------------------------------
+void FsFilePoolBase::dirRelease(uint8_t slot) {
+  if (--m_dir[slot].refs == 0) {
+    m_dir[slot].file.close();
+  }
+}
+//------------------------------------------------------------------------------
+uint8_t FsFilePoolBase::liveSlot() {
+  uint8_t slot = 0;
+  for (uint8_t i = 0; i < m_liveCount; i++) {
+    if (!m_live[i].file.isOpen()) {
+      return i;
+    }
+    if ((m_clock - m_live[i].used) > (m_clock - m_live[slot].used)) {
+      slot = i;
+    }
+  }
+  return park(slot) ? slot : NO_SLOT;
+}
+//------------------------------------------------------------------------------
+bool FsFilePoolBase::open(FsPoolFile* file, const char* dirPath,
+                          const char* name, oflag_t oflag) {
+  uint16_t handle;
+  uint8_t slot;
+  uint8_t dir = NO_SLOT;
+  Entry_t* e;
+  if (!m_vol || file->isOpen()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  for (handle = 0; handle < m_entryCount; handle++) {
+    if (m_entry[handle].dir == NO_SLOT) {
+      break;
+    }
+  }
+  if (handle == m_entryCount) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  dir = dirOpen(dirPath);
+  if (dir == NO_SLOT) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  slot = liveSlot();
+  if (slot == NO_SLOT) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (!m_live[slot].file.open(&m_dir[dir].file, name, oflag)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_live[slot].handle = handle;
+  m_live[slot].used = ++m_clock;
+  e = &m_entry[handle];
+  e->dirIndex = m_live[slot].file.dirIndex();
+  // Reopen must not create, truncate or seek to end again.
+  e->flags = entryFlags(oflag);
+  e->dir = dir;
+  e->live = slot;
+  m_openCount++;
+  file->m_pool = this;
+  file->m_handle = handle;
+  return true;
+
+ fail:
+  if (dir != NO_SLOT) {
+    dirRelease(dir);
+  }
+  return false;
+}
+//------------------------------------------------------------------------------
+bool FsFilePoolBase::park(uint8_t slot) {
+  Entry_t* e = &m_entry[m_live[slot].handle];
+  uint64_t pos = m_live[slot].file.curPosition();
+  if ((pos >> 40) || !m_live[slot].file.close()) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  e->position = pos;
+  e->positionHigh = pos >> 32;
+  e->live = NO_SLOT;
+  return true;
+}
+//------------------------------------------------------------------------------
+bool FsFilePoolBase::sync() {
+  bool rtn = true;
+  for (uint8_t i = 0; i < m_liveCount; i++) {
+    if (m_live[i].file.isOpen() && !m_live[i].file.sync()) {
+      rtn = false;
+    }
+  }
+  return rtn;
+}
@@ -0,0 +1,239 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef FsFilePool_h
+#define FsFilePool_h
+/**
+ * \file
+ * \brief Pool of compact file handles.
+ */
+#include "FsLib/FsLib.h"
+class FsFilePoolBase;
+//------------------------------------------------------------------------------
+/**
+ * \class FsPoolFile
+ * \brief Handle for a file opened in an FsFilePool.
+ *
+ * A handle is a pool pointer and an index.  Calls that access the file
+ * reopen it in one of the pool's live slots if it has been parked.
+ */
+class FsPoolFile {
+ public:
+  FsPoolFile() : m_pool(nullptr), m_handle(0) {}
+  /** Close the file.
+   *
+   * \return true for success or false for failure.
+   */
+  bool close();
+  /** \return The current position of the file. */
+  uint64_t curPosition() const;
+  /** Return the file object for this handle.  The file is reopened in
+   * a live slot if needed.  The pointer is valid until the next call
+   * to the pool for another handle.
+   *
+   * \return Pointer to the file or nullptr for failure.
+   */
+  FsBaseFile* file();
+  /** \return The total number of bytes in the file. */
+  uint64_t fileSize() {
+    FsBaseFile* f = file();
+    return f ? f->fileSize() : 0;
+  }
+  /** \return true if the file is open. */
+  bool isOpen() const {return m_pool;}
+  /** Read data from the file.
+   *
+   * \param[out] buf Location for data.
+   * \param[in] count Maximum number of bytes to read.
+   * \return Number of bytes read or -1 for failure.
+   */
+  int read(void* buf, size_t count) {
+    FsBaseFile* f = file();
+    return f ? f->read(buf, count) : -1;
+  }
+  /** Set the file's position.
+   *
+   * \param[in] pos New position in bytes.
+   * \return true for success or false for failure.
+   */
+  bool seekSet(uint64_t pos) {
+    FsBaseFile* f = file();
+    return f && f->seekSet(pos);
+  }
+  /** Write the file's directory entry and flush the volume cache.
+   *
+   * \return true for success or false for failure.
+   */
+  bool sync();
+  /** Write data to the file.
+   *
+   * \param[in] buf Data to write.
+   * \param[in] count Number of bytes to write.
+   * \return Number of bytes written or zero for failure.
+   */
+  size_t write(const void* buf, size_t count) {
+    FsBaseFile* f = file();
+    return f ? f->write(buf, count) : 0;
+  }
+
+ private:
+  friend class FsFilePoolBase;
+  FsFilePoolBase* m_pool;
+  uint16_t m_handle;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class FsFilePoolBase
+ * \brief Pool of compact file handles.
+ *
+ * Each open file is a small entry with its directory slot, directory
+ * index, open flags and parked position.  A few live slots hold full
+ * FsBaseFile objects for the files most recently used.  When a parked
+ * file is accessed the least recently used live file is synced and
+ * closed, then the parked file is reopened by directory index and its
+ * position restored.  Directories are shared by all files opened in
+ * them.
+ *
+ * Files in the working set stay in live slots so reads and writes have
+ * no extra cost.  Reopening a parked file reads its directory entry and,
+ * for a fragmented file, follows its cluster chain to the old position.
+ */
+class FsFilePoolBase {
+ public:
+  /** Initialize the pool.
+   *
+   * \param[in] vol Volume for files opened in the pool.
+   */
+  void begin(FsVolume* vol);
+  /** Open a file in the root directory.
+   *
+   * \param[out] file Handle for the file.
+   * \param[in] name File name.
+   * \param[in] oflag Open flags, see FsBaseFile::open().
+   * \return true for success or false for failure.
+   */
+  bool open(FsPoolFile* file, const char* name, oflag_t oflag = O_RDONLY) {
+    return open(file, "/", name, oflag);
+  }
+  /** Open a file.
+   *
+   * \param[out] file Handle for the file.
+   * \param[in] dirPath Path of the file's directory.
+   * \param[in] name Path of the file relative to dirPath.
+   * \param[in] oflag Open flags, see FsBaseFile::open().
+   * \return true for success or false for failure.
+   */
+  bool open(FsPoolFile* file, const char* dirPath,
+            const char* name, oflag_t oflag = O_RDONLY);
+  /** \return Number of open files. */
+  uint16_t openCount() const {return m_openCount;}
+  /** \return Number of times a parked file was reopened. */
+  uint32_t reopenCount() const {return m_reopenCount;}
+  /** Sync all live files.
+   *
+   * \return true for success or false for failure.
+   */
+  bool sync();
+
+ protected:
+  /** \cond SHOW_PROTECTED */
+  static const uint8_t NO_SLOT = 0XFF;
+  // Twelve bytes, flags are packed since oflag_t may be wider than a byte.
+  struct Entry_t {
+    uint32_t dirIndex;
+    uint32_t position;
+    uint8_t flags;
+    uint8_t positionHigh;
+    uint8_t dir;
+    uint8_t live;
+  };
+  struct Live_t {
+    FsBaseFile file;
+    uint32_t used;
+    uint16_t handle;
+  };
+  struct Dir_t {
+    FsBaseFile file;
+    uint16_t refs;
+  };
+  FsFilePoolBase(Entry_t* entry, uint16_t entryCount,
+                 Live_t* live, uint8_t liveCount,
+                 Dir_t* dir, uint8_t dirCount) :
+    m_vol(nullptr), m_entry(entry), m_live(live), m_dir(dir),
+    m_entryCount(entryCount), m_openCount(0),
+    m_liveCount(liveCount), m_dirCount(dirCount),
+    m_clock(0), m_reopenCount(0) {}
+  /** \endcond */
+
+ private:
+  friend class FsPoolFile;
+  FsBaseFile* acquire(uint16_t handle);
+  bool close(uint16_t handle);
+  uint8_t dirOpen(const char* path);
+  void dirRelease(uint8_t slot);
+  uint8_t liveSlot();
+  bool park(uint8_t slot);
+
+  FsVolume* m_vol;
+  Entry_t* m_entry;
+  Live_t* m_live;
+  Dir_t* m_dir;
+  uint16_t m_entryCount;
+  uint16_t m_openCount;
+  uint8_t m_liveCount;
+  uint8_t m_dirCount;
+  uint32_t m_clock;
+  uint32_t m_reopenCount;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class FsFilePool
+ * \brief Pool for \a FILES open files with \a LIVE live slots and
+ * \a DIRS shared directories.
+ */
+template<uint16_t FILES, uint8_t LIVE = 4, uint8_t DIRS = 2>
+class FsFilePool : public FsFilePoolBase {
+ public:
+  FsFilePool() :
+    FsFilePoolBase(m_entryArray, FILES, m_liveArray, LIVE, m_dirArray, DIRS) {
+    static_assert(LIVE > 0 && LIVE < NO_SLOT && DIRS > 0 && DIRS < NO_SLOT,
+                  "invalid slot count");
+  }
+
+ private:
+  Entry_t m_entryArray[FILES];
+  Live_t m_liveArray[LIVE];
+  Dir_t m_dirArray[DIRS];
+};
+//------------------------------------------------------------------------------
+inline bool FsPoolFile::close() {
+  FsFilePoolBase* pool = m_pool;
+  m_pool = nullptr;
+  return pool && pool->close(m_handle);
+}
+//------------------------------------------------------------------------------
+inline FsBaseFile* FsPoolFile::file() {
+  return m_pool ? m_pool->acquire(m_handle) : nullptr;
+}
+#endif  // FsFilePool_h
@@ -110,6 +110,11 @@ class FsBaseFile {
     return m_fFile ? m_fFile->curPosition() :
            m_xFile ? m_xFile->curPosition() : 0;
   }
+  /** \return Allocated length of a file, exFAT valid length may be less. */
+  uint64_t dataLength() const {
+    return m_fFile ? m_fFile->fileSize() :
+           m_xFile ? m_xFile->dataLength() : 0;
+  }
   /** \return Directory entry index. */
   uint32_t dirIndex() const {
     return m_fFile ? m_fFile->dirIndex() :
@@ -388,6 +393,10 @@ class FsBaseFile {
    *
    * O_AT_END - Set the initial position at the end of the file.
    *
+   * O_DIRECT - Transfer data between the caller's buffer and the device
+   * without using the volume cache.  The file position and the size of
+   * each read() or write() must be a multiple of the sector size.
+   *
    * O_CREAT - If the file exists, this flag has no effect except as noted
    * under O_EXCL below. Otherwise, the file shall be created
    *
@@ -474,12 +483,19 @@ class FsBaseFile {
    * exFAT files will have zero validLength and dataLength will equal
    * the requested length.
    *
+   * If \a erase is true the clusters are erased so later writes do not
+   * wait for the card to erase flash.  Partial allocation units at each
+   * end are not erased.  The erase is advisory, the result does not
+   * depend on erase success.  Ignored if USE_PREALLOCATE_ERASE is zero.
+   *
    * \param[in] length size of the file in bytes.
+   * \param[in] erase Erase the allocated clusters.
    * \return true for success or false for failure.
    */
-  bool preAllocate(uint64_t length) {
-    return m_fFile ? length < (1ULL << 32) && m_fFile->preAllocate(length) :
-           m_xFile ? m_xFile->preAllocate(length) : false;
+  bool preAllocate(uint64_t length, bool erase = false) {
+    return m_fFile ? length < (1ULL << 32) &&
+                     m_fFile->preAllocate(length, erase) :
+           m_xFile ? m_xFile->preAllocate(length, erase) : false;
   }
   /** Print a file's access date and time
    *
@@ -25,20 +25,56 @@
 #include "FsLib.h"
 FsVolume* FsVolume::m_cwv = nullptr;
 //------------------------------------------------------------------------------
-bool FsVolume::begin(BlockDevice* blockDev) {
+bool FsVolume::begin(BlockDevice* blockDev, uint8_t part) {
+  // Volume memory is the sector buffer until a volume is constructed.
+  uint8_t* buf = reinterpret_cast<uint8_t*>(m_volMem);
+  pbs_t* pbs = reinterpret_cast<pbs_t*>(buf);
+  uint8_t bpb[sizeof(pbs->bpb)];
+  uint32_t volStart = 0;
+  bool exFat;
+  static_assert(sizeof(m_volMem) >= 512, "volume memory too small");
   m_blockDev = blockDev;
   m_fVol = nullptr;
-  m_xVol = new (m_volMem) ExFatVolume;
-  if (m_xVol && m_xVol->begin(m_blockDev, false)) {
-    goto done;
-  }
   m_xVol = nullptr;
-  m_fVol = new (m_volMem) FatVolume;
-  if (m_fVol && m_fVol->begin(m_blockDev, false)) {
-    goto done;
+  if (part > 4 || !m_blockDev->readSector(0, buf)) {
+    goto fail;
+  }
+  if (part) {
+    MbrPart_t* mp = reinterpret_cast<MbrSector_t*>(buf)->part + part - 1;
+    if (mp->type == 0 || (mp->boot != 0 && mp->boot != 0X80)) {
+      goto fail;
+    }
+    volStart = getLe32(mp->relativeSectors);
+    if (!m_blockDev->readSector(volStart, buf)) {
+      goto fail;
+    }
+  }
+  exFat = !strncmp(pbs->oemName, "EXFAT", 5);
+  memcpy(bpb, pbs->bpb, sizeof(bpb));
+  if (exFat) {
+    m_xVol = new (m_volMem) ExFatVolume;
+#if USE_CLUSTER_DISCARD
+    m_xVol->setDiscardPolicy(m_discardPolicy);
+#endif  // USE_CLUSTER_DISCARD
+    if (m_xVol->begin(m_blockDev, false, volStart,
+                      reinterpret_cast<BpbExFat_t*>(bpb))) {
+      goto done;
+    }
+    m_xVol = nullptr;
+  } else {
+    m_fVol = new (m_volMem) FatVolume;
+#if USE_CLUSTER_DISCARD
+    m_fVol->setDiscardPolicy(m_discardPolicy);
+#endif  // USE_CLUSTER_DISCARD
+    if (m_fVol->begin(m_blockDev, false, volStart,
+                      reinterpret_cast<BpbFat32_t*>(bpb))) {
+      goto done;
+    }
+    m_fVol = nullptr;
   }
+
+ fail:
   m_cwv = nullptr;
-  m_fVol = nullptr;
   return false;
 
  done:
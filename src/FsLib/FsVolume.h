@@ -44,11 +44,15 @@ class FsVolume {
   ~FsVolume() {end();}
 
   /**
-   * Initialize an FatVolume object.
+   * Initialize an FsVolume object.  The MBR and partition boot sector are
+   * read once and the BIOS parameter block is passed to the FAT or exFAT
+   * volume class.
    * \param[in] blockDev Device block driver.
+   * \param[in] part partition to initialize, 1-4 for a MBR device or zero
+   * for a super floppy.
    * \return true for success or false for failure.
    */
-  bool begin(BlockDevice* blockDev);
+  bool begin(BlockDevice* blockDev, uint8_t part = 1);
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
   // Use sectorsPerCluster(). blocksPerCluster() will be removed in the future.
   uint32_t blocksPerCluster() __attribute__ ((deprecated)) {return sectorsPerCluster();} //NOLINT
@@ -119,6 +123,18 @@ class FsVolume {
     return m_fVol ? m_fVol->freeClusterCount() :
            m_xVol ? m_xVol->freeClusterCount() : 0;
   }
+  /** Count free clusters with bounded work per call.
+   *
+   * \param[in] budget Maximum number of FAT or bitmap sectors to read.
+   * \param[out] count Count of free clusters if the count is done.
+   *
+   * \return 1 if the count is done, 0 if more calls are required,
+   * or -1 if an error occurs.
+   */
+  int8_t freeClusterCountStep(uint32_t budget, uint32_t* count) {
+    return m_fVol ? m_fVol->freeClusterCountStep(budget, count) :
+           m_xVol ? m_xVol->freeClusterCountStep(budget, count) : -1;
+  }
   /**
    * Check for BlockDevice busy.
    *
@@ -231,6 +247,63 @@ class FsVolume {
     return m_fVol ? m_fVol->rmdir(path) :
            m_xVol ? m_xVol->rmdir(path) : false;
   }
+#if USE_CLUSTER_DISCARD
+  /** Erase freed clusters that are queued for discard.
+   *
+   * \return true for success or false for failure.
+   */
+  bool discard() {
+    return m_fVol ? m_fVol->discard() :
+           m_xVol ? m_xVol->discard() : false;
+  }
+  /** \return Discard counters or nullptr if no volume. */
+  FsDiscardStats_t* discardStats() {
+    return m_fVol ? m_fVol->discardStats() :
+           m_xVol ? m_xVol->discardStats() : nullptr;
+  }
+  /** Set discard policy for freed clusters.  The policy is kept
+   * by later calls to begin().
+   *
+   * \param[in] policy DISCARD_OFF, DISCARD_INLINE, DISCARD_AT_SYNC
+   * or DISCARD_IDLE.
+   */
+  void setDiscardPolicy(uint8_t policy) {
+    m_discardPolicy = policy;
+    if (m_fVol) {
+      m_fVol->setDiscardPolicy(policy);
+    } else if (m_xVol) {
+      m_xVol->setDiscardPolicy(policy);
+    }
+  }
+#endif  // USE_CLUSTER_DISCARD
+#if USE_EXFAT_RAM_BITMAP
+  /** \return Size in bytes of a buffer for the exFAT allocation bitmap or
+   * zero if the volume is not exFAT.
+   */
+  uint32_t bitmapBufferSize() const {
+    return m_xVol ? m_xVol->bitmapBufferSize() : 0;
+  }
+  /** Hold the exFAT allocation bitmap in RAM.
+   *
+   * \param[in] buf Buffer for the bitmap or nullptr to stop using a buffer.
+   * \param[in] size Size of \a buf, at least bitmapBufferSize().
+   *
+   * \return true for success or false for failure or a FAT volume.
+   */
+  bool setBitmapBuffer(uint8_t* buf, size_t size) {
+    return m_xVol ? m_xVol->setBitmapBuffer(buf, size) : false;
+  }
+#endif  // USE_EXFAT_RAM_BITMAP
+#if USE_MOUNT_HINTS
+  /** Save the next free cluster and free cluster count for the next mount.
+   *
+   * \return true for success or false for failure.
+   */
+  bool saveHints() {
+    return m_fVol ? m_fVol->saveHints() :
+           m_xVol ? m_xVol->saveHints() : false;
+  }
+#endif  // USE_MOUNT_HINTS
   /** \return The volume's cluster size in sectors. */
   uint32_t sectorsPerCluster() const {
     return m_fVol ? m_fVol->sectorsPerCluster() :
@@ -381,5 +454,8 @@ class FsVolume {
   FatVolume*   m_fVol = nullptr;
   ExFatVolume* m_xVol = nullptr;
   BlockDevice* m_blockDev;
+#if USE_CLUSTER_DISCARD
+  uint8_t m_discardPolicy = DISCARD_AT_SYNC;
+#endif  // USE_CLUSTER_DISCARD
 };
 #endif  // FsVolume_h
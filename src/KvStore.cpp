@@ -0,0 +1,511 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#define DBG_FILE "KvStore.cpp"
+#include "common/DebugMacros.h"
+#include "common/FsStructs.h"
+#include "KvStore.h"
+// Region header sector.
+const uint32_t KV_FILE_MAGIC = 0X3153564B;  // "KVS1"
+const uint8_t KV_HDR_GEN = 4;
+const uint8_t KV_HDR_SECTORS = 8;
+const uint8_t KV_HDR_ACTIVE = 12;
+const uint8_t KV_HDR_CHECK = 16;
+// Data sector starts with the region generation.
+const uint16_t KV_DATA_START = 4;
+// Record: magic, key length, value length, check, key, value.
+const uint8_t KV_RECORD_MAGIC = 0XA5;
+const uint8_t KV_REC_KEY_LEN = 1;
+const uint8_t KV_REC_VAL_LEN = 2;
+const uint8_t KV_REC_CHECK = 4;
+const uint8_t KV_REC_KEY = 6;
+const uint16_t KV_DELETED = 0XFFFF;
+//------------------------------------------------------------------------------
+static uint32_t kvHash(const uint8_t* key, uint8_t n) {
+  // FNV-1a
+  uint32_t h = 2166136261UL;
+  while (n--) {
+    h = (h ^ *key++)*16777619UL;
+  }
+  return h;
+}
+//------------------------------------------------------------------------------
+static uint16_t kvTag(uint32_t hash) {
+  return hash ^ (hash >> 16);
+}
+//------------------------------------------------------------------------------
+static uint16_t kvCheck(const uint8_t* rec) {
+  uint16_t valLen = getLe16(rec + KV_REC_VAL_LEN);
+  uint16_t n = rec[KV_REC_KEY_LEN] + (valLen == KV_DELETED ? 0 : valLen);
+  // Fletcher-16 over lengths, key and value.
+  uint16_t s1 = rec[1] + rec[2] + rec[3];
+  uint16_t s2 = 3*rec[1] + 2*rec[2] + rec[3];
+  for (const uint8_t* p = rec + KV_REC_KEY; n--; p++) {
+    s1 = (s1 + *p)%255;
+    s2 = (s2 + s1)%255;
+  }
+  return (s2%255) << 8 | (s1%255);
+}
+//------------------------------------------------------------------------------
+static uint16_t kvRecordSize(const uint8_t* rec) {
+  uint16_t valLen = getLe16(rec + KV_REC_VAL_LEN);
+  return KV_REC_KEY + rec[KV_REC_KEY_LEN] + (valLen == KV_DELETED ? 0 : valLen);
+}
+//------------------------------------------------------------------------------
+static uint32_t kvHdrCheck(const uint8_t* hdr) {
+  uint32_t sum = 0;
+  for (uint8_t i = 0; i < KV_HDR_CHECK; i++) {
+    sum = ((sum << 1) | (sum >> 31)) + hdr[i];
+  }
+  return sum;
+}
+//------------------------------------------------------------------------------
+bool KvStoreBase::append(const uint8_t* key, uint8_t keyLen,
+                         const void* value, uint16_t valLen, KvSlot_t* loc) {
+  uint16_t size = KV_REC_KEY + keyLen + (valLen == KV_DELETED ? 0 : valLen);
+  uint32_t sector;
+  uint8_t* rec;
+  if ((m_tailUsed + size) > 512 &&
+      (m_tailSector + 1) >= m_regionSectors && !compact()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if ((m_tailUsed + size) > 512) {
+    if ((m_tailSector + 1) >= m_regionSectors) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    newTail(m_gen, m_tailSector + 1);
+  }
+  rec = m_tail + m_tailUsed;
+  rec[0] = KV_RECORD_MAGIC;
+  rec[KV_REC_KEY_LEN] = keyLen;
+  setLe16(rec + KV_REC_VAL_LEN, valLen);
+  memcpy(rec + KV_REC_KEY, key, keyLen);
+  if (valLen != KV_DELETED) {
+    memcpy(rec + KV_REC_KEY + keyLen, value, valLen);
+  }
+  setLe16(rec + KV_REC_CHECK, kvCheck(rec));
+  sector = regionStart(m_region) + m_tailSector;
+  if (m_bufSector == sector) {
+    // Cache copy is stale once the tail is written.
+    m_bufSector = NO_SECTOR;
+  }
+  if (!m_dev->writeSector(sector, m_tail)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  loc->sector = m_tailSector;
+  loc->offset = m_tailUsed;
+  m_tailUsed += size;
+  return true;
+
+ fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool KvStoreBase::begin(BlockDevice* dev, FsBaseFile* file, bool format) {
+  uint32_t gen[2];
+  bool active[2];
+  uint64_t ns;
+  m_dev = dev;
+  m_bufSector = NO_SECTOR;
+  m_nextGen = 1;
+  if (!file->isContiguous() && !file->contiguousRange(nullptr, nullptr)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  ns = (file->dataLength() >> 9)/2;
+  if (ns < 2) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_regionSectors = ns > 0X7FFFFFFF ? 0X7FFFFFFF : ns;
+  m_firstSector = file->firstSector();
+  for (uint8_t r = 0; r < 2; r++) {
+    uint8_t* hdr = cacheGet(regionStart(r));
+    if (!hdr) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    bool valid = getLe32(hdr) == KV_FILE_MAGIC &&
+                 getLe32(hdr + KV_HDR_SECTORS) == m_regionSectors &&
+                 getLe32(hdr + KV_HDR_CHECK) == kvHdrCheck(hdr);
+    gen[r] = getLe32(hdr + KV_HDR_GEN);
+    active[r] = valid && getLe32(hdr + KV_HDR_ACTIVE) == 1;
+    // Generations of an unfinished compaction may be in data sectors.
+    if (valid && (int32_t)(gen[r] - m_nextGen) >= 0) {
+      m_nextGen = gen[r] + 1;
+    }
+  }
+  m_region = active[1] &&
+             (!active[0] || (int32_t)(gen[1] - gen[0]) > 0) ? 1 : 0;
+  if (format) {
+    m_region = 0;
+    m_gen = m_nextGen++;
+    clearIndex();
+    newTail(m_gen, 1);
+    if (!writeHeader(0, m_gen, true)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    return true;
+  }
+  if (!active[m_region]) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_gen = gen[m_region];
+  if (!load()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  return true;
+
+ fail:
+  m_dev = nullptr;
+  return false;
+}
+//------------------------------------------------------------------------------
+uint8_t* KvStoreBase::cacheGet(uint32_t sector) {
+  if (m_bufSector != sector) {
+    m_bufSector = NO_SECTOR;
+    if (!m_dev->readSector(sector, m_buf)) {
+      DBG_FAIL_MACRO;
+      return nullptr;
+    }
+    m_bufSector = sector;
+  }
+  return m_buf;
+}
+//------------------------------------------------------------------------------
+void KvStoreBase::clearIndex() {
+  m_count = 0;
+  for (uint16_t i = 0; i < m_slotCount; i++) {
+    m_slots[i].sector = 0;
+  }
+}
+//------------------------------------------------------------------------------
+bool KvStoreBase::compact() {
+  uint8_t region = m_region ^ 1;
+  uint32_t gen = m_nextGen++;
+  uint32_t oldStart = regionStart(m_region);
+  uint32_t newStart = regionStart(region);
+  // Record use of gen so stale sectors never match a later generation.
+  if (!m_dev || !writeHeader(region, gen, false)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  newTail(gen, 1);
+  for (uint16_t i = 0; i < m_slotCount; i++) {
+    KvSlot_t* slot = &m_slots[i];
+    if (slot->sector == 0) {
+      continue;
+    }
+    uint8_t* buf = cacheGet(oldStart + slot->sector);
+    if (!buf) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    uint8_t* rec = buf + slot->offset;
+    uint16_t size = kvRecordSize(rec);
+    if ((m_tailUsed + size) > 512) {
+      if (!m_dev->writeSector(newStart + m_tailSector, m_tail) ||
+          (m_tailSector + 1) >= m_regionSectors) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      newTail(gen, m_tailSector + 1);
+    }
+    memcpy(m_tail + m_tailUsed, rec, size);
+    slot->sector = m_tailSector;
+    slot->offset = m_tailUsed;
+    m_tailUsed += size;
+  }
+  if (!m_dev->writeSector(newStart + m_tailSector, m_tail) ||
+      !writeHeader(region, gen, true)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_region = region;
+  m_gen = gen;
+  return true;
+
+ fail:
+  if (m_dev) {
+    // Old region is still valid.  Rebuild index from it.
+    m_bufSector = NO_SECTOR;
+    if (!load()) {
+      m_dev = nullptr;
+    }
+  }
+  return false;
+}
+//------------------------------------------------------------------------------
+// Return index of key or of empty slot for key.  Return m_slotCount on error.
+uint16_t KvStoreBase::find(const uint8_t* key, uint8_t keyLen,
+                           uint16_t tag, bool* found) {
+  uint16_t i = tag%m_slotCount;
+  *found = false;
+  while (m_slots[i].sector) {
+    if (m_slots[i].tag == tag) {
+      const uint8_t* rec = record(&m_slots[i]);
+      if (!rec) {
+        return m_slotCount;
+      }
+      if (rec[KV_REC_KEY_LEN] == keyLen &&
+          memcmp(rec + KV_REC_KEY, key, keyLen) == 0) {
+        *found = true;
+        break;
+      }
+    }
+    i = i + 1 < m_slotCount ? i + 1 : 0;
+  }
+  return i;
+}
+//------------------------------------------------------------------------------
+int KvStoreBase::get(const char* key, void* value, size_t size) {
+  const uint8_t* k = reinterpret_cast<const uint8_t*>(key);
+  size_t keyLen = strlen(key);
+  const uint8_t* rec;
+  uint16_t valLen;
+  bool found;
+  uint16_t i;
+  if (!m_dev || keyLen == 0 || keyLen > 255) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  i = find(k, keyLen, kvTag(kvHash(k, keyLen)), &found);
+  if (!found) {
+    goto fail;
+  }
+  // Record is in cache or tail after find().
+  rec = record(&m_slots[i]);
+  valLen = getLe16(rec + KV_REC_VAL_LEN);
+  memcpy(value, rec + KV_REC_KEY + keyLen, valLen < size ? valLen : size);
+  return valLen;
+
+ fail:
+  return -1;
+}
+//------------------------------------------------------------------------------
+bool KvStoreBase::load() {
+  uint32_t start = regionStart(m_region);
+  uint32_t last = 0;
+  uint16_t used = KV_DATA_START;
+  // No tail while the index is rebuilt.
+  m_tailSector = 0;
+  clearIndex();
+  for (uint32_t s = 1; s < m_regionSectors; s++) {
+    uint8_t* buf = cacheGet(start + s);
+    if (!buf) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (getLe32(buf) != m_gen) {
+      break;
+    }
+    uint16_t offset = KV_DATA_START;
+    while ((offset + KV_REC_KEY) <= 512 && buf[offset] == KV_RECORD_MAGIC) {
+      uint8_t* rec = buf + offset;
+      uint16_t size = kvRecordSize(rec);
+      if ((offset + size) > 512 ||
+          getLe16(rec + KV_REC_CHECK) != kvCheck(rec)) {
+        break;
+      }
+      if (!update(rec, s, offset)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      // update() may read other sectors.
+      buf = cacheGet(start + s);
+      if (!buf) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      offset += size;
+    }
+    last = s;
+    used = offset;
+  }
+  if (last == 0) {
+    newTail(m_gen, 1);
+  } else {
+    uint8_t* buf = cacheGet(start + last);
+    if (!buf) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    memcpy(m_tail, buf, 512);
+    m_tailSector = last;
+    m_tailUsed = used;
+  }
+  // The tail is in m_tail, appends do not update the cache.
+  m_bufSector = NO_SECTOR;
+  return true;
+
+ fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+void KvStoreBase::newTail(uint32_t gen, uint32_t sector) {
+  memset(m_tail, 0, sizeof(m_tail));
+  setLe32(m_tail, gen);
+  m_tailSector = sector;
+  m_tailUsed = KV_DATA_START;
+}
+//------------------------------------------------------------------------------
+bool KvStoreBase::put(const char* key, const void* value, size_t size) {
+  const uint8_t* k = reinterpret_cast<const uint8_t*>(key);
+  size_t keyLen = strlen(key);
+  uint16_t tag = kvTag(kvHash(k, keyLen));
+  KvSlot_t loc;
+  bool found;
+  uint16_t i;
+  if (!m_dev || keyLen == 0 || keyLen > 255 ||
+      (KV_DATA_START + KV_REC_KEY + keyLen + size) > 512) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  i = find(k, keyLen, tag, &found);
+  if (i == m_slotCount || (!found && (m_count + 1) >= m_slotCount)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (!append(k, keyLen, value, size, &loc)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (!found) {
+    m_count++;
+  }
+  m_slots[i].sector = loc.sector;
+  m_slots[i].offset = loc.offset;
+  m_slots[i].tag = tag;
+  return true;
+
+ fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+const uint8_t* KvStoreBase::record(const KvSlot_t* slot) {
+  if (slot->sector == m_tailSector) {
+    return m_tail + slot->offset;
+  }
+  uint8_t* buf = cacheGet(regionStart(m_region) + slot->sector);
+  return buf ? buf + slot->offset : nullptr;
+}
+//------------------------------------------------------------------------------
+bool KvStoreBase::remove(const char* key) {
+  const uint8_t* k = reinterpret_cast<const uint8_t*>(key);
+  size_t keyLen = strlen(key);
+  KvSlot_t loc;
+  bool found;
+  uint16_t i;
+  if (!m_dev || keyLen == 0 || keyLen > 255) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  i = find(k, keyLen, kvTag(kvHash(k, keyLen)), &found);
+  if (!found || !append(k, keyLen, nullptr, KV_DELETED, &loc)) {
+    goto fail;
+  }
+  removeSlot(i);
+  m_count--;
+  return true;
+
+ fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+// Backward shift deletion for linear probing.
+void KvStoreBase::removeSlot(uint16_t i) {
+  uint16_t j = i;
+  for (;;) {
+    j = j + 1 < m_slotCount ? j + 1 : 0;
+    if (m_slots[j].sector == 0) {
+      break;
+    }
+    uint16_t home = m_slots[j].tag%m_slotCount;
+    if (i <= j ? (i < home && home <= j) : (i < home || home <= j)) {
+      continue;
+    }
+    m_slots[i] = m_slots[j];
+    i = j;
+  }
+  m_slots[i].sector = 0;
+}
+//------------------------------------------------------------------------------
+bool KvStoreBase::update(const uint8_t* rec, uint32_t sector,
+                         uint16_t offset) {
+  uint8_t keyLen = rec[KV_REC_KEY_LEN];
+  bool deleted = getLe16(rec + KV_REC_VAL_LEN) == KV_DELETED;
+  uint8_t key[255];
+  uint16_t tag;
+  bool found;
+  uint16_t i;
+  // Copy key since find() may replace the cache.
+  memcpy(key, rec + KV_REC_KEY, keyLen);
+  tag = kvTag(kvHash(key, keyLen));
+  i = find(key, keyLen, tag, &found);
+  if (i == m_slotCount) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (deleted) {
+    if (found) {
+      removeSlot(i);
+      m_count--;
+    }
+    return true;
+  }
+  if (!found) {
+    if ((m_count + 1) >= m_slotCount) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    m_count++;
+  }
+  m_slots[i].sector = sector;
+  m_slots[i].offset = offset;
+  m_slots[i].tag = tag;
+  return true;
+
+ fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool KvStoreBase::writeHeader(uint8_t region, uint32_t gen, bool active) {
+  m_bufSector = NO_SECTOR;
+  memset(m_buf, 0, sizeof(m_buf));
+  setLe32(m_buf, KV_FILE_MAGIC);
+  setLe32(m_buf + KV_HDR_GEN, gen);
+  setLe32(m_buf + KV_HDR_SECTORS, m_regionSectors);
+  setLe32(m_buf + KV_HDR_ACTIVE, active ? 1 : 0);
+  setLe32(m_buf + KV_HDR_CHECK, kvHdrCheck(m_buf));
+  // Sync before and after so the header is ordered with data sectors.
+  return m_dev->syncDevice() &&
+         m_dev->writeSector(regionStart(region), m_buf) &&
+         m_dev->syncDevice();
+}
@@ -0,0 +1,153 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef KvStore_h
+#define KvStore_h
+/**
+ * \file
+ * \brief Log structured key-value store in a preallocated file.
+ */
+#include "common/BlockDevice.h"
+#include "FsLib/FsLib.h"
+/** Location of a key in the log. */
+struct KvSlot_t {
+  /** Sector in region, zero for an empty slot. */
+  uint32_t sector;
+  /** Offset of record in sector. */
+  uint16_t offset;
+  /** Folded key hash, also selects the home slot. */
+  uint16_t tag;
+};
+/**
+ * \class KvStoreBase
+ * \brief Log structured key-value store in a preallocated file.
+ *
+ * The file is split into two regions.  Each region has a header sector
+ * with a generation number followed by a log of records.  Records never
+ * span sectors so get() and put() access a single sector.  The sector
+ * being filled is written after each put() so an update is saved when
+ * put() returns.
+ *
+ * An index in RAM maps key hashes to record locations.  It is rebuilt
+ * by scanning the log in begin().
+ *
+ * When the active region is full, live records are copied to the other
+ * region and its header is written with a new generation.  A power
+ * failure during compaction leaves the old region active.  Removing a
+ * key appends a record so put() and remove() fail if live records fill
+ * a region.
+ */
+class KvStoreBase {
+ public:
+  /** Start use of a contiguous file.
+   *
+   * \param[in] dev Block device for the file's volume.
+   * \param[in] file Contiguous file. See FsBaseFile::preAllocate().
+   * \param[in] format Set true to remove all keys.
+   * \return true for success or false for failure.
+   */
+  bool begin(BlockDevice* dev, FsBaseFile* file, bool format = false);
+  /** Copy live records to the other region.
+   * \return true for success or false for failure.  The store is
+   * unchanged if live records do not fit in a region.
+   */
+  bool compact();
+  /** \return Number of keys. */
+  uint16_t count() const {return m_count;}
+  /** Get the value of a key.
+   *
+   * \param[in] key Key string.
+   * \param[out] value Location for value.
+   * \param[in] size Size of \a value.
+   * \return Length of value, -1 if key not found or an error occurs.
+   */
+  int get(const char* key, void* value, size_t size);
+  /** Add or replace a key.
+   *
+   * \param[in] key Key string.
+   * \param[in] value Value.
+   * \param[in] size Length of value.
+   * \return true for success or false for failure.
+   */
+  bool put(const char* key, const void* value, size_t size);
+  /** Remove a key.
+   *
+   * \param[in] key Key string.
+   * \return true for success or false if key not found or an error occurs.
+   */
+  bool remove(const char* key);
+
+ protected:
+  /** \cond SHOW_PROTECTED */
+  KvStoreBase(KvSlot_t* slots, uint16_t slotCount) :
+    m_dev(nullptr), m_slots(slots), m_slotCount(slotCount) {}
+  /** \endcond */
+
+ private:
+  static const uint32_t NO_SECTOR = 0XFFFFFFFF;
+  bool append(const uint8_t* key, uint8_t keyLen,
+              const void* value, uint16_t valLen, KvSlot_t* loc);
+  uint8_t* cacheGet(uint32_t sector);
+  void clearIndex();
+  uint16_t find(const uint8_t* key, uint8_t keyLen,
+                uint16_t tag, bool* found);
+  bool load();
+  void newTail(uint32_t gen, uint32_t sector);
+  const uint8_t* record(const KvSlot_t* slot);
+  uint32_t regionStart(uint8_t region) const {
+    return m_firstSector + region*m_regionSectors;
+  }
+  void removeSlot(uint16_t i);
+  bool update(const uint8_t* rec, uint32_t sector, uint16_t offset);
+  bool writeHeader(uint8_t region, uint32_t gen, bool active);
+
+  BlockDevice* m_dev;
+  KvSlot_t* m_slots;
+  uint16_t m_slotCount;
+  uint16_t m_count;
+  uint8_t m_region;
+  uint32_t m_gen;
+  uint32_t m_nextGen;
+  uint32_t m_firstSector;
+  uint32_t m_regionSectors;
+  uint32_t m_tailSector;
+  uint16_t m_tailUsed;
+  uint32_t m_bufSector;
+  uint8_t m_buf[512];
+  uint8_t m_tail[512];
+};
+//------------------------------------------------------------------------------
+/**
+ * \class KvStore
+ * \brief Key-value store with index for up to \a N - 1 keys.
+ */
+template<uint16_t N>
+class KvStore : public KvStoreBase {
+ public:
+  KvStore() : KvStoreBase(m_slotArray, N) {}
+
+ private:
+  KvSlot_t m_slotArray[N];
+};
+#endif  // KvStore_h
@@ -0,0 +1,157 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef LogPump_h
+#define LogPump_h
+/**
+ * \file
+ * \brief Drain a RingBuf to a file when the card is idle.
+ */
+#include "RingBuf.h"
+/**
+ * \class LogPump
+ * \brief Drain a RingBuf to a file when the card is idle.
+ *
+ * Call poll() in the logging loop.  A sector is written only when the
+ * card is not busy so the write does not wait for the card.  If a high
+ * water mark is set and the RingBuf fills past it, all buffered sectors
+ * are written with one multi-sector write.  That write blocks the loop
+ * while the card is busy so it is off by default.  If a deadline is set,
+ * a sector is written even if the card is busy once the deadline has
+ * passed since the last write.
+ *
+ * poll() counts RingBuf write errors as overruns and clears the error.
+ * Data copied in an ISR with memcpyIn() does not set the write error.
+ */
+template<class F, size_t Size>
+class LogPump {
+ public:
+  LogPump() {}
+  /**
+   * Initialize the RingBuf and the pump.
+   *
+   * \param[in] rb RingBuf to drain.
+   * \param[in] file File for data.  It should be preallocated.
+   * \param[in] maxSize Maximum file size or zero for no limit.
+   */
+  void begin(RingBuf<F, Size>* rb, F* file, uint64_t maxSize = 0) {
+    m_rb = rb;
+    m_file = file;
+    m_maxSize = maxSize;
+    m_rb->begin(file);
+    m_maxUsed = 0;
+    m_overrunCount = 0;
+    m_busyWriteCount = 0;
+    m_writeError = false;
+    m_lastWrite = millis();
+  }
+  /** \return Number of writes issued while the card was busy. */
+  uint32_t busyWriteCount() const {return m_busyWriteCount;}
+  /**
+   * Write all buffered data and truncate the file at the end of the data.
+   *
+   * \return true for success or false for failure.
+   */
+  bool end() {
+    bool rtn = !m_writeError && m_rb->sync();
+    return m_file->truncate() && rtn;
+  }
+  /**
+   * Check for space in the file.
+   *
+   * \param[in] reserve Space needed after buffered data.
+   * \return true if the file is full.
+   */
+  bool isFull(size_t reserve = 0) {
+    return m_maxSize &&
+      (m_file->curPosition() + m_rb->bytesUsed() + reserve) > m_maxSize;
+  }
+  /** \return Maximum bytes used in the RingBuf. */
+  size_t maxBytesUsed() const {return m_maxUsed;}
+  /** \return Number of RingBuf write errors seen by poll(). */
+  uint32_t overrunCount() const {return m_overrunCount;}
+  /**
+   * Write RingBuf data to the file if a write is due.
+   *
+   * \return false for a write error else true.
+   */
+  bool poll() {
+    size_t n = m_rb->bytesUsed();
+    if (n > m_maxUsed) {
+      m_maxUsed = n;
+    }
+    if (m_rb->getWriteError()) {
+      m_overrunCount++;
+      m_rb->clearWriteError();
+    }
+    if (m_writeError) {
+      return false;
+    }
+    if (n < 512) {
+      return true;
+    }
+    if (m_file->isBusy()) {
+      if (!m_deadline || (millis() - m_lastWrite) < m_deadline) {
+        return true;
+      }
+      m_busyWriteCount++;
+    }
+    // Catch up with one multi-sector write if the RingBuf is filling.
+    size_t count = m_highWater < Size && n >= m_highWater ?
+                   n & ~(size_t)511 : 512;
+    if (m_rb->writeOut(count) != count) {
+      m_writeError = true;
+      return false;
+    }
+    m_lastWrite = millis();
+    return true;
+  }
+  /**
+   * Set the maximum time between writes when data is waiting.
+   *
+   * \param[in] ms Deadline in milliseconds or zero for no deadline.
+   */
+  void setDeadline(uint32_t ms) {m_deadline = ms;}
+  /**
+   * Set the RingBuf fill level for multi-sector writes.  A multi-sector
+   * write catches up faster but blocks poll() until the card finishes.
+   *
+   * \param[in] bytes Fill level.  The default, Size, disables
+   * multi-sector writes.
+   */
+  void setHighWater(size_t bytes) {m_highWater = bytes;}
+
+ private:
+  RingBuf<F, Size>* m_rb = nullptr;
+  F* m_file = nullptr;
+  uint64_t m_maxSize = 0;
+  size_t m_highWater = Size;
+  size_t m_maxUsed = 0;
+  uint32_t m_deadline = 0;
+  uint32_t m_lastWrite = 0;
+  uint32_t m_overrunCount = 0;
+  uint32_t m_busyWriteCount = 0;
+  bool m_writeError = false;
+};
+#endif  // LogPump_h
@@ -0,0 +1,329 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#define DBG_FILE "RingFile.cpp"
+#include "common/DebugMacros.h"
+#include "common/FsStructs.h"
+#include "RingFile.h"
+// Header layout.
+const uint32_t RING_FILE_MAGIC = 0X4C464E52;  // "RNFL"
+const uint8_t RING_MAGIC = 0;
+const uint8_t RING_SEQ = 4;
+const uint8_t RING_DATA_COUNT = 8;
+const uint8_t RING_HEAD = 16;
+const uint8_t RING_TAIL = 24;
+const uint8_t RING_CHECKSUM = 32;
+//------------------------------------------------------------------------------
+static uint32_t ringChecksum(const uint8_t* data) {
+  uint32_t sum = 0;
+  for (uint8_t i = 0; i < RING_CHECKSUM; i++) {
+    sum = ((sum << 1) | (sum >> 31)) + data[i];
+  }
+  return sum;
+}
+//------------------------------------------------------------------------------
+bool RingFile::begin(BlockDevice* dev, FsBaseFile* file, bool format) {
+  uint64_t ns;
+  uint32_t seq0;
+  uint32_t seq1;
+  bool ok0;
+  bool ok1;
+  m_dev = dev;
+  m_bufSector = NO_SECTOR;
+  m_dirty = false;
+  if (!file->isContiguous() && !file->contiguousRange(nullptr, nullptr)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  ns = file->dataLength() >> 9;
+  if (ns < 4) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_firstSector = file->firstSector();
+  m_dataSector = m_firstSector + 2;
+  m_dataCount = ns - 2 > 0XFFFFFFFF ? 0XFFFFFFFF : ns - 2;
+  if (format) {
+    m_seq = 0;
+    m_head = 0;
+    m_tail = 0;
+    // Write both copies so an old header can't be selected.
+    if (!writeHeader(0) || !writeHeader(0)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  } else {
+    ok1 = readHeader(1, &seq1);
+    ok0 = readHeader(0, &seq0);
+    if (!ok0 && !ok1) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (!ok0 || (ok1 && (int32_t)(seq1 - seq0) > 0)) {
+      // Slot one is newer.
+      if (!readHeader(1, &seq1)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+    }
+  }
+  m_syncHead = m_head;
+  m_readPos = m_tail;
+  return true;
+
+ fail:
+  m_dev = nullptr;
+  return false;
+}
+//------------------------------------------------------------------------------
+bool RingFile::cacheFlush() {
+  if (m_dirty) {
+    if (!m_dev->writeSector(sector(m_bufSector), m_buf)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    m_dirty = false;
+  }
+  return true;
+
+ fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+uint8_t* RingFile::cacheGet(uint64_t ls, bool read) {
+  if (m_bufSector != ls) {
+    if (!cacheFlush()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    m_bufSector = NO_SECTOR;
+    if (read && !m_dev->readSector(sector(ls), m_buf)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    m_bufSector = ls;
+  }
+  return m_buf;
+
+ fail:
+  return nullptr;
+}
+//------------------------------------------------------------------------------
+int RingFile::read(void* buf, size_t count) {
+  uint8_t* dst = reinterpret_cast<uint8_t*>(buf);
+  size_t n;
+  if (!m_dev) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (m_readPos < m_tail) {
+    m_readPos = m_tail;
+  }
+  if (count > m_head - m_readPos) {
+    count = m_head - m_readPos;
+  }
+  n = count;
+  while (n) {
+    uint64_t ls = m_readPos >> 9;
+    uint16_t offset = m_readPos & 0X1FF;
+    size_t k;
+    if (offset == 0 && n >= 512) {
+      uint32_t ns = n >> 9;
+      if (ns > sectorsToWrap(ls)) {
+        ns = sectorsToWrap(ls);
+      }
+      if ((m_bufSector - ls) < ns && !cacheFlush()) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      if (!m_dev->readSectors(sector(ls), dst, ns)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      k = (size_t)ns << 9;
+    } else {
+      uint8_t* src = cacheGet(ls, true);
+      if (!src) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      k = 512 - offset;
+      if (k > n) {
+        k = n;
+      }
+      memcpy(dst, src + offset, k);
+    }
+    m_readPos += k;
+    dst += k;
+    n -= k;
+  }
+  return count;
+
+ fail:
+  return -1;
+}
+//------------------------------------------------------------------------------
+bool RingFile::readHeader(uint8_t slot, uint32_t* seq) {
+  m_bufSector = NO_SECTOR;
+  if (!m_dev->readSector(m_firstSector + slot, m_buf)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (getLe32(m_buf + RING_MAGIC) != RING_FILE_MAGIC ||
+      getLe32(m_buf + RING_CHECKSUM) != ringChecksum(m_buf) ||
+      getLe32(m_buf + RING_DATA_COUNT) != m_dataCount) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  *seq = getLe32(m_buf + RING_SEQ);
+  m_seq = *seq;
+  m_head = getLe64(m_buf + RING_HEAD);
+  m_tail = getLe64(m_buf + RING_TAIL);
+  if (m_tail > m_head) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  return true;
+
+ fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+// Advance tail so writing data before logical offset end is safe.
+bool RingFile::reserve(uint64_t end) {
+  // One data sector stays free so a full ring is not read as empty.
+  uint64_t lastSector = (end + 511) >> 9;
+  uint64_t need = lastSector > (m_dataCount - 1) ?
+                  (lastSector - (m_dataCount - 1)) << 9 : 0;
+  uint64_t tail;
+  if (m_tail >= need) {
+    return true;
+  }
+  // Move tail by at least one eighth of the ring to limit header writes.
+  tail = need + ((uint64_t)(m_dataCount >> 3) << 9);
+  if (tail > (end & ~(uint64_t)0X1FF)) {
+    tail = end & ~(uint64_t)0X1FF;
+  }
+  m_tail = tail;
+  return writeHeader(m_syncHead > tail ? m_syncHead : tail);
+}
+//------------------------------------------------------------------------------
+bool RingFile::sync() {
+  if (!m_dev || !cacheFlush() || !writeHeader(m_head)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_syncHead = m_head;
+  return true;
+
+ fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+size_t RingFile::write(const void* buf, size_t count) {
+  const uint8_t* src = reinterpret_cast<const uint8_t*>(buf);
+  size_t n = count;
+  if (!m_dev) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  while (n) {
+    uint64_t ls = m_head >> 9;
+    uint16_t offset = m_head & 0X1FF;
+    size_t k;
+    if (offset == 0 && n >= 512) {
+      uint32_t ns = n >> 9;
+      if (ns > sectorsToWrap(ls)) {
+        ns = sectorsToWrap(ls);
+      }
+      if (ns > (m_dataCount - 1)) {
+        ns = m_dataCount - 1;
+      }
+      k = (size_t)ns << 9;
+      if (!reserve(m_head + k)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      cacheInvalidate(ls, ns);
+      if (!m_dev->writeSectors(sector(ls), src, ns)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+    } else {
+      k = 512 - offset;
+      if (k > n) {
+        k = n;
+      }
+      if (!reserve(m_head + k)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      // Start of a new sector doesn't need a read.
+      uint8_t* dst = cacheGet(ls, offset != 0);
+      if (!dst) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      memcpy(dst + offset, src, k);
+      m_dirty = true;
+      if ((offset + k) == 512 && !cacheFlush()) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+    }
+    m_head += k;
+    src += k;
+    n -= k;
+  }
+  return count;
+
+ fail:
+  return 0;
+}
+//------------------------------------------------------------------------------
+// Data must be on the device before the header.
+bool RingFile::writeHeader(uint64_t head) {
+  if (!cacheFlush() || !m_dev->syncDevice()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_bufSector = NO_SECTOR;
+  m_seq++;
+  memset(m_buf, 0, sizeof(m_buf));
+  setLe32(m_buf + RING_MAGIC, RING_FILE_MAGIC);
+  setLe32(m_buf + RING_SEQ, m_seq);
+  setLe32(m_buf + RING_DATA_COUNT, m_dataCount);
+  setLe64(m_buf + RING_HEAD, head);
+  setLe64(m_buf + RING_TAIL, m_tail);
+  setLe32(m_buf + RING_CHECKSUM, ringChecksum(m_buf));
+  if (!m_dev->writeSector(m_firstSector + (m_seq & 1), m_buf) ||
+      !m_dev->syncDevice()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  return true;
+
+ fail:
+  return false;
+}
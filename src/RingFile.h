@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef RingFile_h
+#define RingFile_h
+/**
+ * \file
+ * \brief Circular log in a preallocated contiguous file.
+ */
+#include "common/BlockDevice.h"
+#include "FsLib/FsLib.h"
+/**
+ * \class RingFile
+ * \brief Circular log in a preallocated contiguous file.
+ *
+ * The first two sectors of the file hold alternate copies of a header
+ * with the head and tail of the log.  The remaining sectors hold data.
+ * Data sectors are accessed directly on the block device with single
+ * and multiple sector commands so no cluster allocation or directory
+ * update occurs after begin().
+ *
+ * When the log is full the tail advances by at least one eighth of the
+ * data area.  The header is written before any old data is overwritten
+ * so the log is consistent after a power failure.  Data written after
+ * the last sync() may be lost.
+ *
+ * The file must not be accessed with file functions while in use as a
+ * RingFile.
+ */
+class RingFile {
+ public:
+  RingFile() : m_dev(nullptr) {}
+  /** Start use of a file as a circular log.
+   *
+   * \param[in] dev Block device for the file's volume.
+   * \param[in] file Contiguous file. See FsBaseFile::preAllocate().
+   * \param[in] format Set true to clear the log.
+   * \return true for success or false for failure.
+   */
+  bool begin(BlockDevice* dev, FsBaseFile* file, bool format = false);
+  /** \return Number of bytes in the log. */
+  uint64_t bytesUsed() const {return m_head - m_tail;}
+  /** \return Maximum number of bytes the log can hold. */
+  uint64_t capacity() const {return (uint64_t)(m_dataCount - 1) << 9;}
+  /** \return Logical offset of the end of the log. */
+  uint64_t head() const {return m_head;}
+  /** Read data from oldest to newest.
+   *
+   * Read position moves to the tail if older data has been overwritten.
+   *
+   * \param[out] buf Location for data.
+   * \param[in] count Maximum number of bytes to read.
+   * \return Number of bytes read or -1 for failure.
+   */
+  int read(void* buf, size_t count);
+  /** \return Logical offset of the next byte returned by read(). */
+  uint64_t readPosition() const {
+    return m_readPos < m_tail ? m_tail : m_readPos;
+  }
+  /** Set read position to the oldest data. */
+  void rewind() {m_readPos = m_tail;}
+  /** Save data and update the header.
+   * \return true for success or false for failure.
+   */
+  bool sync();
+  /** \return Logical offset of the oldest data in the log. */
+  uint64_t tail() const {return m_tail;}
+  /** Append data to the log, overwriting the oldest data if needed.
+   *
+   * \param[in] buf Data to write.
+   * \param[in] count Number of bytes to write.
+   * \return \a count for success or zero for failure.
+   */
+  size_t write(const void* buf, size_t count);
+
+ private:
+  static const uint64_t NO_SECTOR = ~(uint64_t)0;
+  bool cacheFlush();
+  uint8_t* cacheGet(uint64_t ls, bool read);
+  void cacheInvalidate(uint64_t ls, uint32_t ns) {
+    if (m_bufSector - ls < ns) {
+      m_bufSector = NO_SECTOR;
+    }
+  }
+  bool readHeader(uint8_t slot, uint32_t* seq);
+  bool reserve(uint64_t end);
+  uint32_t sector(uint64_t ls) const {
+    return m_dataSector + ls % m_dataCount;
+  }
+  uint32_t sectorsToWrap(uint64_t ls) const {
+    return m_dataCount - ls % m_dataCount;
+  }
+  bool writeHeader(uint64_t head);
+
+  BlockDevice* m_dev;
+  uint32_t m_firstSector;
+  uint32_t m_dataSector;
+  uint32_t m_dataCount;
+  uint32_t m_seq;
+  uint64_t m_head;
+  uint64_t m_tail;
+  uint64_t m_syncHead;
+  uint64_t m_readPos;
+  uint64_t m_bufSector;
+  bool m_dirty;
+  uint8_t m_buf[512];
+};
+#endif  // RingFile_h
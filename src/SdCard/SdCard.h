@@ -72,6 +72,17 @@ class SdCardFactory {
     return nullptr;
 #endif  // HAS_SDIO_CLASS
   }
+  /** Resume SPI card after MCU sleep.
+   *
+   * \param[in] config SPI configuration.
+   * \return generic card pointer.
+   */
+  SdCard* resumeCard(SdSpiConfig config) {
+    m_spiCard.resume(config);
+    return &m_spiCard;
+  }
+  /** \return Pointer to the SPI card object. */
+  SdSpiCard* spiCard() {return &m_spiCard;}
 
  private:
 #if HAS_SDIO_CLASS
@@ -83,7 +83,8 @@
   SD_CARD_ERROR(ERASE_TIMEOUT, "Erase command timeout")\
   SD_CARD_ERROR(INIT_NOT_CALLED, "Card has not been initialized")\
   SD_CARD_ERROR(INVALID_CARD_CONFIG, "Invalid card config")\
-  SD_CARD_ERROR(FUNCTION_NOT_SUPPORTED, "Unsupported SDIO command")
+  SD_CARD_ERROR(FUNCTION_NOT_SUPPORTED, "Unsupported SDIO command")\
+  SD_CARD_ERROR(ACMD51, "Read SCR register")
 
 enum {
 #define  SD_CARD_ERROR(e, m) SD_CARD_ERROR_##e,
@@ -170,6 +171,8 @@ const uint8_t ACMD23 = 0X17;
 /** SD_SEND_OP_COMD - Sends host capacity support information and
     activates the card's initialization process */
 const uint8_t ACMD41 = 0X29;
+/** SEND_SCR - Reads the SD Configuration Register (SCR). */
+const uint8_t ACMD51 = 0X33;
 //==============================================================================
 // CARD_STATUS
 /** The command's argument was out of the allowed range for this card. */
@@ -486,5 +489,12 @@ typedef struct SdStatus {
   uint8_t reserved2[3];
   uint8_t reservedManufacturer[40];
 } SdStatus_t;
+//-----------------------------------------------------------------------------
+// AU_SIZE in 512 byte sectors, zero if not defined.
+inline uint32_t sdsAuSectors(const SdStatus_t* sds) {
+  static const uint16_t large[] = {256, 384, 512, 768, 1024, 2048};
+  uint8_t au = sds->auSize >> 4;
+  return au == 0 ? 0 : au < 10 ? 32UL << (au - 1) : 64UL*large[au - 10];
+}
 #endif  // DOXYGEN_SHOULD_SKIP_THIS
 #endif  // SdCardInfo_h
@@ -68,6 +68,12 @@ class SdCardInterface : public BlockDeviceInterface {
    * \return true for success or false for failure.
    */
   virtual bool readOCR(uint32_t* ocr) = 0;
+  /** Read SCR register.
+   *
+   * \param[out] scr Location for the 8 byte, big endian, SCR.
+   * \return true for success or false for failure.
+   */
+  virtual bool readSCR(uint8_t* scr) {(void)scr; return false;}
   /**
    * Determine the size of an SD flash memory card.
    *
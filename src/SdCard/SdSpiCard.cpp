@@ -220,8 +220,80 @@ static uint16_t CRC_CCITT(const uint8_t* data, size_t n) {
 //==============================================================================
 // SdSpiCard member functions
 //------------------------------------------------------------------------------
+#if USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+uint32_t SdSpiCard::auSectors() {
+  SdStatus_t sds;
+  uint32_t n;
+  if (!readStatus(reinterpret_cast<uint8_t*>(&sds))) {
+    return 1;
+  }
+  n = sdsAuSectors(&sds);
+  return n ? n : 1;
+}
+#endif  // USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+//------------------------------------------------------------------------------
 bool SdSpiCard::begin(SdSpiConfig spiConfig) {
   SdMillis_t t0 = SysCall::curTimeMS();
+  int8_t status;
+  if (!initStart(spiConfig)) {
+    goto fail;
+  }
+  while ((status = initPoll(t0)) == 0) {}
+  if (status < 0) {
+    goto fail;
+  }
+  spiStop();
+  spiSetSckSpeed(spiConfig.maxSck);
+  return true;
+
+ fail:
+  spiStop();
+  return false;
+}
+//------------------------------------------------------------------------------
+bool SdSpiCard::beginAll(SdSpiCard* const* cards,
+                         const SdSpiConfig* configs, size_t count) {
+  SdMillis_t t0 = SysCall::curTimeMS();
+  size_t todo = 0;
+  bool rtn = true;
+  // All cards must be deselected before any card is accessed.
+  for (size_t i = 0; i < count; i++) {
+    sdCsInit(configs[i].csPin);
+    sdCsWrite(configs[i].csPin, true);
+  }
+  for (size_t i = 0; i < count; i++) {
+    if (cards[i]->initStart(configs[i])) {
+      todo++;
+    } else {
+      rtn = false;
+    }
+    cards[i]->spiStop();
+  }
+  // Poll cards in turn so the slowest card sets the total init time.
+  while (todo) {
+    for (size_t i = 0; i < count; i++) {
+      if (cards[i]->m_errorCode != SD_CARD_ERROR_INIT_NOT_CALLED) {
+        continue;
+      }
+      int8_t status = cards[i]->initPoll(t0);
+      cards[i]->spiStop();
+      if (status == 0) {
+        continue;
+      }
+      if (status > 0) {
+        cards[i]->m_errorCode = SD_CARD_ERROR_NONE;
+        cards[i]->spiSetSckSpeed(configs[i].maxSck);
+      } else {
+        rtn = false;
+      }
+      todo--;
+    }
+  }
+  return rtn;
+}
+//------------------------------------------------------------------------------
+// Select card and run CMD0 and CMD8.  Card is left selected.
+bool SdSpiCard::initStart(SdSpiConfig spiConfig) {
   m_spiActive = false;
   m_errorCode = SD_CARD_ERROR_NONE;
   m_type = 0;
@@ -237,7 +309,6 @@ bool SdSpiCard::begin(SdSpiConfig spiConfig) {
   spiUnselect();
   spiSetSckSpeed(1000UL*SD_MAX_INIT_RATE_KHZ);
   spiBegin(spiConfig);
-  uint32_t arg;
 #if ENABLE_DEDICATED_SPI
   m_curState = IDLE_STATE;
   m_sharedSpi = spiOptionShared(spiConfig.options);
@@ -292,16 +363,27 @@ bool SdSpiCard::begin(SdSpiConfig spiConfig) {
   } else {
     type(SD_CARD_TYPE_SD1);
   }
-  // initialize card and send host supports SDHC if SD2
-  arg = type() == SD_CARD_TYPE_SD2 ? 0X40000000 : 0;
+  // Not ready until ACMD41 completes.
+  m_errorCode = SD_CARD_ERROR_INIT_NOT_CALLED;
   DBG_BEGIN_TIME(DBG_ACMD41_TIME);
-  while (cardAcmd(ACMD41, arg) != R1_READY_STATE) {
+  return true;
+
+ fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+// Send one ACMD41.  Return -1 error, 0 not ready, 1 ready.
+int8_t SdSpiCard::initPoll(SdMillis_t t0) {
+  // initialize card and send host supports SDHC if SD2
+  uint32_t arg = type() == SD_CARD_TYPE_SD2 ? 0X40000000 : 0;
+  if (cardAcmd(ACMD41, arg) != R1_READY_STATE) {
     DBG_EVENT_COUNT(DBG_ACMD41_COUNT);
     // check for timeout
     if (isTimedOut(t0, SD_INIT_TIMEOUT)) {
       error(SD_CARD_ERROR_ACMD41);
-      goto fail;
+      return -1;
     }
+    return 0;
   }
   DBG_END_TIME(DBG_ACMD41_TIME);
 
@@ -309,7 +391,7 @@ bool SdSpiCard::begin(SdSpiConfig spiConfig) {
   if (type() == SD_CARD_TYPE_SD2) {
     if (cardCommand(CMD58, 0)) {
       error(SD_CARD_ERROR_CMD58);
-      goto fail;
+      return -1;
     }
     if ((spiReceive() & 0XC0) == 0XC0) {
       type(SD_CARD_TYPE_SDHC);
@@ -319,13 +401,8 @@ bool SdSpiCard::begin(SdSpiConfig spiConfig) {
       spiReceive();
     }
   }
-  spiStop();
-  spiSetSckSpeed(spiConfig.maxSck);
-  return true;
-
- fail:
-  spiStop();
-  return false;
+  m_errorCode = SD_CARD_ERROR_NONE;
+  return 1;
 }
 //------------------------------------------------------------------------------
 // send command and return error code.  Return zero for OK
@@ -529,6 +606,24 @@ bool SdSpiCard::readOCR(uint32_t* ocr) {
   spiStop();
   return false;
 }
+#if USE_PREALLOCATE_ERASE
+//------------------------------------------------------------------------------
+bool SdSpiCard::readSCR(uint8_t* scr) {
+  if (cardAcmd(ACMD51, 0)) {
+    error(SD_CARD_ERROR_ACMD51);
+    goto fail;
+  }
+  if (!readData(scr, 8)) {
+    goto fail;
+  }
+  spiStop();
+  return true;
+
+ fail:
+  spiStop();
+  return false;
+}
+#endif  // USE_PREALLOCATE_ERASE
 //------------------------------------------------------------------------------
 /** read CID or CSR register */
 bool SdSpiCard::readRegister(uint8_t cmd, void* buf) {
@@ -645,6 +740,36 @@ bool SdSpiCard::readStop() {
   return false;
 }
 //------------------------------------------------------------------------------
+bool SdSpiCard::resume(SdSpiConfig spiConfig) {
+  if (m_errorCode != SD_CARD_ERROR_NONE || m_type == 0) {
+    return begin(spiConfig);
+  }
+  m_spiActive = false;
+  m_csPin = spiConfig.csPin;
+#if SPI_DRIVER_SELECT >= 2
+  m_spiDriverPtr = spiConfig.spiPort;
+  if (!m_spiDriverPtr) {
+    error(SD_CARD_ERROR_INVALID_CARD_CONFIG);
+    return false;
+  }
+#endif  // SPI_DRIVER_SELECT
+  sdCsInit(m_csPin);
+  spiUnselect();
+  spiSetSckSpeed(spiConfig.maxSck);
+  spiBegin(spiConfig);
+#if ENABLE_DEDICATED_SPI
+  m_curState = IDLE_STATE;
+  m_sharedSpi = spiOptionShared(spiConfig.options);
+#endif  // ENABLE_DEDICATED_SPI
+  // A card that kept power is still in transfer state.  Response is R2.
+  if (cardCommand(CMD13, 0) || spiReceive()) {
+    spiStop();
+    return begin(spiConfig);
+  }
+  spiStop();
+  return true;
+}
+//------------------------------------------------------------------------------
 uint32_t SdSpiCard::sectorCount() {
   csd_t csd;
   return readCSD(&csd) ? sdCardCapacity(&csd) : 0;
@@ -53,6 +53,19 @@ class SdSpiCard {
    * \return true for success or false for failure.
    */
   bool begin(SdSpiConfig spiConfig);
+  /** Initialize several SD cards on separate chip select pins.
+   *
+   * ACMD41 polling is interleaved so the total time is set by the
+   * slowest card, not the sum of all cards.
+   *
+   * \param[in] cards Array of pointers to the cards.
+   * \param[in] configs Array of SPI configurations, one for each card.
+   * \param[in] count Number of cards.
+   * \return true if all cards were initialized.  Check errorCode()
+   * of each card if false is returned.
+   */
+  static bool beginAll(SdSpiCard* const* cards,
+                       const SdSpiConfig* configs, size_t count);
   /** Clear debug stats. */
   void dbgClearStats();
   /** Print debug stats. */
@@ -68,6 +81,27 @@ class SdSpiCard {
   // Use sectorCount(). cardSize() will be removed in the future.
   uint32_t cardSize() __attribute__ ((deprecated)) {return sectorCount();}
 #endif  // DOXYGEN_SHOULD_SKIP_THIS
+#if USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+  /** \return Allocation unit size in sectors from the SD status or
+   * one if not known.
+   */
+  uint32_t auSectors();
+#endif  // USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+#if USE_PREALLOCATE_ERASE
+  /** Get the value of bytes read from erased sectors.
+   *
+   * \param[out] value Zero or 0XFF from SCR DATA_STAT_AFTER_ERASE.
+   * \return true for success or false for failure.
+   */
+  bool dataAfterErase(uint8_t* value) {
+    uint8_t scr[8];
+    if (!readSCR(scr)) {
+      return false;
+    }
+    *value = scr[1] & 0X80 ? 0XFF : 0;
+    return true;
+  }
+#endif  // USE_PREALLOCATE_ERASE
   /** Erase a range of sectors.
    *
    * \param[in] firstSector The address of the first sector in the range.
@@ -178,6 +212,14 @@ class SdSpiCard {
    * \return true for success or false for failure.
    */
   bool readOCR(uint32_t* ocr);
+#if USE_PREALLOCATE_ERASE
+  /** Read SCR register.
+   *
+   * \param[out] scr Location for the 8 byte, big endian, SCR.
+   * \return true for success or false for failure.
+   */
+  bool readSCR(uint8_t* scr);
+#endif  // USE_PREALLOCATE_ERASE
   /** Start a read multiple sector sequence.
    *
    * \param[in] sector Address of first sector in sequence.
@@ -198,6 +240,16 @@ class SdSpiCard {
    * \return true for success or false for failure.
    */
   bool readStop();
+  /** Resume use of a card after MCU sleep.
+   *
+   * The card type from the last successful initialization is reused if the
+   * card answers CMD13 at full speed.  The full initialization sequence of
+   * begin() is used if the card lost power or was never initialized.
+   *
+   * \param[in] spiConfig SPI card configuration.
+   * \return true for success or false for failure.
+   */
+  bool resume(SdSpiConfig spiConfig);
   /** \return success if sync successful. Not for user apps. */
   bool syncDevice();
   /** Return the card type: SD V1, SD V2 or SDHC/SDXC
@@ -281,6 +333,8 @@ class SdSpiCard {
     return cardCommand(cmd, arg);
   }
   uint8_t cardCommand(uint8_t cmd, uint32_t arg);
+  int8_t initPoll(SdMillis_t t0);
+  bool initStart(SdSpiConfig spiConfig);
   bool isTimedOut(SdMillis_t startMS, SdMillis_t timeoutMS);
   bool readData(uint8_t* dst, size_t count);
   bool readRegister(uint8_t cmd, void* buf);
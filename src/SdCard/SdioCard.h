@@ -69,6 +69,27 @@ class SdioCard : public SdCardInterface {
   // Use sectorCount(). cardSize() will be removed in the future.
   uint32_t cardSize() __attribute__ ((deprecated)) {return sectorCount();}
 #endif  // DOXYGEN_SHOULD_SKIP_THIS
+#if USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+  /** \return Allocation unit size in sectors from the SD status or
+   * one if not known.
+   */
+  uint32_t auSectors();
+#endif  // USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+#if USE_PREALLOCATE_ERASE
+  /** Get the value of bytes read from erased sectors.
+   *
+   * \param[out] value Zero or 0XFF from SCR DATA_STAT_AFTER_ERASE.
+   * \return true for success or false for failure.
+   */
+  bool dataAfterErase(uint8_t* value) {
+    uint8_t scr[8];
+    if (!readSCR(scr)) {
+      return false;
+    }
+    *value = scr[1] & 0X80 ? 0XFF : 0;
+    return true;
+  }
+#endif  // USE_PREALLOCATE_ERASE
   /** Erase a range of sectors.
    *
    * \param[in] firstSector The address of the first sector in the range.
@@ -147,6 +168,19 @@ class SdioCard : public SdCardInterface {
    * \return true for success or false for failure.
    */
   bool readOCR(uint32_t* ocr);
+#if USE_PREALLOCATE_ERASE
+  /** Read SCR register.
+   *
+   * \param[out] scr Location for the 8 byte, big endian, SCR.
+   * \return true for success or false for failure.
+   */
+  bool readSCR(uint8_t* scr);
+#endif  // USE_PREALLOCATE_ERASE
+  /** Return the 64 byte SD status.
+   * \param[out] status location for 64 status bytes.
+   * \return true for success or false for failure.
+   */
+  bool readStatus(uint8_t* status);
   /** Start a read multiple sectors sequence.
    *
    * \param[in] sector Address of first sector in sequence.
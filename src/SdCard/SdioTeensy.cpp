@@ -128,8 +128,14 @@ const uint32_t DATA_WRITE_MULTI_PGM = SDHC_XFERTYP_DPSEL | SDHC_MIX_CTRL_MSBSEL;
 
 const uint32_t ACMD6_XFERTYP = SDHC_XFERTYP_CMDINX(ACMD6) | CMD_RESP_R1;
 
+const uint32_t ACMD13_XFERTYP = SDHC_XFERTYP_CMDINX(ACMD13) | CMD_RESP_R1 |
+                                DATA_READ_DMA;
+
 const uint32_t ACMD41_XFERTYP = SDHC_XFERTYP_CMDINX(ACMD41) | CMD_RESP_R3;
 
+const uint32_t ACMD51_XFERTYP = SDHC_XFERTYP_CMDINX(ACMD51) | CMD_RESP_R1 |
+                                DATA_READ_DMA;
+
 const uint32_t CMD0_XFERTYP = SDHC_XFERTYP_CMDINX(CMD0) | CMD_RESP_NONE;
 
 const uint32_t CMD2_XFERTYP = SDHC_XFERTYP_CMDINX(CMD2) | CMD_RESP_R2;
@@ -643,6 +649,18 @@ static bool waitTransferComplete() {
 //==============================================================================
 // Start of SdioCard member functions.
 //==============================================================================
+#if USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+uint32_t SdioCard::auSectors() {
+  SdStatus_t sds;
+  uint32_t n;
+  if (!readStatus(reinterpret_cast<uint8_t*>(&sds))) {
+    return 1;
+  }
+  n = sdsAuSectors(&sds);
+  return n ? n : 1;
+}
+#endif  // USE_PREALLOCATE_ERASE || USE_CLUSTER_DISCARD
+//------------------------------------------------------------------------------
 bool SdioCard::begin(SdioConfig sdioConfig) {
   uint32_t kHzSdClk;
   uint32_t arg;
@@ -851,6 +869,28 @@ bool SdioCard::readOCR(uint32_t* ocr) {
   *ocr = m_ocr;
   return true;
 }
+#if USE_PREALLOCATE_ERASE
+//------------------------------------------------------------------------------
+bool SdioCard::readSCR(uint8_t* scr) {
+  // SCR is 8 bytes.  DMA requires an aligned buffer.
+  uint32_t buf[2];
+  if (waitTimeout(isBusyCMD13)) {
+    return sdError(SD_CARD_ERROR_CMD13);
+  }
+  enableDmaIrs();
+  SDHC_DSADDR  = (uint32_t)buf;
+  SDHC_BLKATTR = SDHC_BLKATTR_BLKCNT(1) | SDHC_BLKATTR_BLKSIZE(8);
+  SDHC_IRQSIGEN = SDHC_IRQSIGEN_MASK;
+  if (!cardAcmd(m_rca, ACMD51_XFERTYP, 0)) {
+    return sdError(SD_CARD_ERROR_ACMD51);
+  }
+  if (!waitDmaStatus()) {
+    return sdError(SD_CARD_ERROR_DMA);
+  }
+  memcpy(scr, buf, 8);
+  return true;
+}
+#endif  // USE_PREALLOCATE_ERASE
 //------------------------------------------------------------------------------
 bool SdioCard::readSector(uint32_t sector, uint8_t* dst) {
   if (m_sdioConfig.useDma()) {
@@ -939,6 +979,26 @@ bool SdioCard::readStart(uint32_t sector) {
   return true;
 }
 //------------------------------------------------------------------------------
+bool SdioCard::readStatus(uint8_t* status) {
+  // SD status is 64 bytes.  DMA requires an aligned buffer.
+  uint32_t buf[16];
+  if (waitTimeout(isBusyCMD13)) {
+    return sdError(SD_CARD_ERROR_CMD13);
+  }
+  enableDmaIrs();
+  SDHC_DSADDR  = (uint32_t)buf;
+  SDHC_BLKATTR = SDHC_BLKATTR_BLKCNT(1) | SDHC_BLKATTR_BLKSIZE(64);
+  SDHC_IRQSIGEN = SDHC_IRQSIGEN_MASK;
+  if (!cardAcmd(m_rca, ACMD13_XFERTYP, 0)) {
+    return sdError(SD_CARD_ERROR_ACMD13);
+  }
+  if (!waitDmaStatus()) {
+    return sdError(SD_CARD_ERROR_DMA);
+  }
+  memcpy(status, buf, 64);
+  return true;
+}
+//------------------------------------------------------------------------------
 bool SdioCard::readStop() {
   return transferStop();
 }
@@ -115,6 +115,31 @@ class SdBase : public Vol {
     return m_card && !m_card->errorCode();
   }
   //----------------------------------------------------------------------------
+  /** Resume SD card in SPI mode after MCU sleep.
+   *
+   * The volume is not mounted again.  Call begin() if the card may
+   * have been replaced while asleep.
+   *
+   * \param[in] spiConfig SPI configuration.
+   * \return true for success or false for failure.
+   */
+  bool cardResume(SdSpiConfig spiConfig) {
+    m_card = m_cardFactory.resumeCard(spiConfig);
+    return m_card && !m_card->errorCode();
+  }
+  //----------------------------------------------------------------------------
+  /** Select the SPI card without initializing it.
+   *
+   * Use with SdSpiCard::beginAll() to initialize several cards in
+   * parallel then call volumeBegin() for each SdBase.
+   *
+   * \return Pointer to the SPI card object.
+   */
+  SdSpiCard* spiCard() {
+    m_card = m_cardFactory.spiCard();
+    return m_cardFactory.spiCard();
+  }
+  //----------------------------------------------------------------------------
   /** %Print error info and halt.
    *
    * \param[in] pr Print destination.
@@ -200,6 +200,70 @@ typedef uint8_t SdCsPin_t;
  */
 #define MAINTAIN_FREE_CLUSTER_COUNT 0
 //------------------------------------------------------------------------------
+/**
+ * Set USE_MOUNT_HINTS nonzero to load the next free cluster and the free
+ * cluster count from a hint record when a volume is mounted.  The record is
+ * written by saveHints().  FAT32 uses the FSINFO sector and exFAT uses a
+ * record in the OEM Parameters sector of the main boot region.
+ *
+ * The free cluster count is only used if MAINTAIN_FREE_CLUSTER_COUNT is
+ * nonzero.  Hints are advisory, as for FSINFO, and may be stale if the
+ * volume was modified after the last saveHints() call.  The exFAT record
+ * is marked stale by the first allocation or free after mount.
+ */
+#define USE_MOUNT_HINTS 0
+//------------------------------------------------------------------------------
+/**
+ * Maximum sectors for each erase command when preAllocate() is called with
+ * erase true.  Only whole allocation units, AU_SIZE from the SD status, are
+ * erased.  Each command is a multiple of the allocation unit size so it
+ * finishes within SD_ERASE_TIMEOUT.
+ */
+#define PREALLOCATE_ERASE_SECTORS 262144UL
+//------------------------------------------------------------------------------
+/**
+ * Set USE_PREALLOCATE_ERASE nonzero to erase clusters when preAllocate() is
+ * called with erase true.  This also enables auSectors(), readSCR() and
+ * dataAfterErase() for SD cards.  With USE_PREALLOCATE_ERASE zero,
+ * preAllocate() ignores erase.  USE_CLUSTER_DISCARD also needs auSectors().
+ */
+#if defined(__AVR__) && FLASHEND < 0X8000
+// 32K AVR boards.
+#define USE_PREALLOCATE_ERASE 0
+#else  // defined(__AVR__) && FLASHEND < 0X8000
+// All other boards.
+#define USE_PREALLOCATE_ERASE 1
+#endif  // defined(__AVR__) && FLASHEND < 0X8000
+//------------------------------------------------------------------------------
+/**
+ * Set USE_CLUSTER_DISCARD nonzero to erase clusters freed by remove(),
+ * truncate() and rmdir().  Freed ranges are queued and sent to the card as
+ * erase commands so it can skip copying stale data during wear leveling.
+ *
+ * The volume's setDiscardPolicy() selects when the queue is erased:
+ * DISCARD_INLINE when clusters are freed, DISCARD_AT_SYNC when the volume
+ * is synced, DISCARD_IDLE only when discard() is called, or DISCARD_OFF.
+ * The default is DISCARD_AT_SYNC.  Ranges are dropped if their clusters
+ * are allocated again before they are erased.
+ */
+#define USE_CLUSTER_DISCARD 0
+//------------------------------------------------------------------------------
+/**
+ * Set USE_FREE_EXTENT_INDEX nonzero to keep an index of up to eight free
+ * cluster extents for each volume.  Extents are recorded when clusters are
+ * freed and when preAllocate() scans the FAT or exFAT bitmap.  preAllocate()
+ * takes the smallest indexed extent that fits before it scans.
+ */
+#define USE_FREE_EXTENT_INDEX 0
+//------------------------------------------------------------------------------
+/**
+ * Set USE_SHARED_FILE_STATE nonzero to share file size, first cluster and
+ * contiguous state between files open on the same directory entry.  A file
+ * then reads data written by another file on the same volume without a
+ * sync() or reopen.  Up to four directory entries are shared per volume.
+ */
+#define USE_SHARED_FILE_STATE 0
+//------------------------------------------------------------------------------
 /**
  * To enable SD card CRC checking for SPI, set USE_SD_CRC nonzero.
  *
@@ -249,6 +313,25 @@ typedef uint8_t SdCsPin_t;
  */
 #define FAT12_SUPPORT 0
 //------------------------------------------------------------------------------
+/**
+ * Set FAT16_SUPPORT zero for a FAT32 only build.  FAT entries are then
+ * decoded without a per call dispatch on FAT type and the FAT16 code is
+ * not linked.  FAT12_SUPPORT must also be zero for a FAT32 only build.
+ */
+#define FAT16_SUPPORT 1
+//------------------------------------------------------------------------------
+/**
+ * Set USE_FAT_GET_RANGE nonzero to read FAT entries in batches, with FAT
+ * access functions selected at mount.  This speeds cluster allocation and
+ * the FAT12 free cluster count but uses more flash.  If zero, one entry is
+ * read per call, as in earlier versions.
+ */
+#if defined(__AVR__)
+#define USE_FAT_GET_RANGE 0
+#else  // defined(__AVR__)
+#define USE_FAT_GET_RANGE 1
+#endif  // defined(__AVR__)
+//------------------------------------------------------------------------------
 /**
  * Set DESTRUCTOR_CLOSES_FILE nonzero to close a file in its destructor.
  *
@@ -297,6 +380,14 @@ typedef uint8_t SdCsPin_t;
 #define USE_SEPARATE_FAT_CACHE 0
 #endif  // __arm__
 //------------------------------------------------------------------------------
+/**
+ * Set FAT_READ_AHEAD_SECTORS to the number of FAT16/FAT32 table sectors
+ * read by one command when a FAT sector is not cached.  Following sectors
+ * are then copied from RAM as a cluster chain is walked.  Each sector
+ * costs 512 bytes of RAM in the volume.  Zero disables read-ahead.
+ */
+#define FAT_READ_AHEAD_SECTORS 0
+//------------------------------------------------------------------------------
 /**
  * Set USE_EXFAT_BITMAP_CACHE nonzero to use a second 512 byte cache
  * for exFAT bitmap entries.  This improves performance for large
@@ -308,6 +399,18 @@ typedef uint8_t SdCsPin_t;
 #define USE_EXFAT_BITMAP_CACHE 0
 #endif  // __arm__
 //------------------------------------------------------------------------------
+/**
+ * Set USE_EXFAT_RAM_BITMAP nonzero to allow the exFAT allocation bitmap to
+ * be held in a buffer provided by setBitmapBuffer().  The bitmap is read
+ * when the buffer is set.  Modified sectors are written by one multi-sector
+ * write when the volume is synced.
+ */
+#ifdef __arm__
+#define USE_EXFAT_RAM_BITMAP 1
+#else  // __arm__
+#define USE_EXFAT_RAM_BITMAP 0
+#endif  // __arm__
+//------------------------------------------------------------------------------
 /**
  * Set USE_MULTI_SECTOR_IO nonzero to use multi-sector SD read/write.
  *
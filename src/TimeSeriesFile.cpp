@@ -0,0 +1,364 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#define DBG_FILE "TimeSeriesFile.cpp"
+#include "common/DebugMacros.h"
+#include "common/FsStructs.h"
+#include "TimeSeriesFile.h"
+// Sector layouts.
+const uint32_t TS_FILE_MAGIC = 0X31465354;  // "TSF1"
+const uint16_t TS_DATA_MAGIC = 0X4454;  // "TD"
+const uint16_t TS_INDEX_MAGIC = 0X4954;  // "TI"
+// Data sector: magic, count, reserved, first time, records.
+const uint8_t TS_DATA_COUNT = 2;
+const uint8_t TS_DATA_TIME = 4;
+const uint8_t TS_DATA_RECORDS = 8;
+// Index sector: magic, reserved, group, first time of each data sector.
+const uint8_t TS_INDEX_GROUP = 4;
+const uint8_t TS_INDEX_TIMES = 8;
+//------------------------------------------------------------------------------
+bool TimeSeriesFile::append(uint32_t time, const void* data) {
+  uint8_t* buf;
+  uint8_t* rec;
+  if (!m_file || time < m_lastTime) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (m_dataCount == 0 || m_tailCount == m_perSector) {
+    // Start a new data sector.
+    if (!writeIndex()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    buf = cacheGet(dataSector(m_dataCount), false);
+    if (!buf) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    memset(buf, 0, 512);
+    setLe16(buf, TS_DATA_MAGIC);
+    setLe32(buf + TS_DATA_TIME, time);
+    m_times[m_dataCount%TS_GROUP_SECTORS] = time;
+    m_dataCount++;
+    m_tailCount = 0;
+  } else {
+    buf = cacheGet(dataSector(m_dataCount - 1), true);
+    if (!buf) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+  rec = buf + TS_DATA_RECORDS + m_tailCount*(4 + m_recordSize);
+  setLe32(rec, time);
+  memcpy(rec + 4, data, m_recordSize);
+  buf[TS_DATA_COUNT] = ++m_tailCount;
+  m_dirty = true;
+  m_lastTime = time;
+  // Write full sector now.
+  if (m_tailCount == m_perSector && !cacheFlush()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  return true;
+
+ fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool TimeSeriesFile::begin(BlockDevice* dev, FsBaseFile* file,
+                           uint16_t recordSize) {
+  uint64_t size = file->fileSize();
+  uint8_t* buf;
+  uint32_t ns;
+  uint32_t rem;
+  m_dev = dev;
+  m_file = file;
+  m_bufSector = NO_SECTOR;
+  m_dirty = false;
+  m_readData = 0;
+  m_readIndex = 0;
+  m_dataCount = 0;
+  m_tailCount = 0;
+  m_lastTime = 0;
+  // Sets the contiguous flag for a FAT file.
+  if (size != 0 && !file->isContiguous() &&
+      !file->contiguousRange(nullptr, nullptr)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  buf = cacheGet(0, size != 0);
+  if (!buf) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (size == 0) {
+    if (recordSize == 0 || recordSize > (512 - TS_DATA_RECORDS - 4)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    memset(buf, 0, 512);
+    setLe32(buf, TS_FILE_MAGIC);
+    setLe16(buf + 4, recordSize);
+    buf[6] = TS_GROUP_SECTORS;
+    m_dirty = true;
+    if (!cacheFlush()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  } else {
+    if (getLe32(buf) != TS_FILE_MAGIC || buf[6] != TS_GROUP_SECTORS ||
+        (recordSize && recordSize != getLe16(buf + 4))) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    recordSize = getLe16(buf + 4);
+  }
+  m_recordSize = recordSize;
+  m_perSector = (512 - TS_DATA_RECORDS)/(4 + m_recordSize);
+  ns = (size + 511) >> 9;
+  if (ns > 1) {
+    rem = (ns - 1)%(TS_GROUP_SECTORS + 1);
+    m_dataCount = ((ns - 1)/(TS_GROUP_SECTORS + 1))*TS_GROUP_SECTORS + rem;
+    // Load times for the last group.
+    if (rem == 0) {
+      rem = TS_GROUP_SECTORS;
+    }
+    for (uint32_t d = m_dataCount - rem; d < m_dataCount; d++) {
+      buf = cacheGet(dataSector(d), true);
+      if (!buf || getLe16(buf) != TS_DATA_MAGIC) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      m_times[d%TS_GROUP_SECTORS] = getLe32(buf + TS_DATA_TIME);
+    }
+    m_tailCount = buf[TS_DATA_COUNT];
+    if (m_tailCount == 0 || m_tailCount > m_perSector) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    m_lastTime = getLe32(buf + TS_DATA_RECORDS +
+                         (m_tailCount - 1)*(4 + m_recordSize));
+    // Write an index sector missed by an interrupted session.
+    if (file->isWritable() && !writeIndex()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+  return true;
+
+ fail:
+  m_file = nullptr;
+  return false;
+}
+//------------------------------------------------------------------------------
+bool TimeSeriesFile::cacheFlush() {
+  if (m_dirty) {
+    if (!m_file->seekSet((uint64_t)m_bufSector << 9) ||
+        m_file->write(m_buf, 512) != 512 || !m_file->isContiguous()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    m_dirty = false;
+  }
+  return true;
+
+ fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+uint8_t* TimeSeriesFile::cacheGet(uint32_t sector, bool read) {
+  if (m_bufSector != sector) {
+    if (!cacheFlush()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    m_bufSector = NO_SECTOR;
+    // Contiguous file so no cluster chain walk.
+    if (read && ((uint64_t)sector << 9) >= m_file->fileSize()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (read && !m_dev->readSector(m_file->firstSector() + sector, m_buf)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    m_bufSector = sector;
+  }
+  return m_buf;
+
+ fail:
+  return nullptr;
+}
+//------------------------------------------------------------------------------
+bool TimeSeriesFile::read(uint32_t* time, void* data) {
+  uint8_t* buf;
+  const uint8_t* rec;
+  if (!m_file) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  while (m_readData < m_dataCount) {
+    buf = cacheGet(dataSector(m_readData), true);
+    if (!buf) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (m_readIndex < buf[TS_DATA_COUNT]) {
+      rec = buf + TS_DATA_RECORDS + m_readIndex*(4 + m_recordSize);
+      *time = getLe32(rec);
+      memcpy(data, rec + 4, m_recordSize);
+      m_readIndex++;
+      return true;
+    }
+    if ((m_readData + 1) == m_dataCount) {
+      break;
+    }
+    m_readData++;
+    m_readIndex = 0;
+  }
+
+ fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool TimeSeriesFile::seekTime(uint32_t time) {
+  uint32_t lo = 0;
+  uint32_t hi;
+  uint32_t tailGroup;
+  uint32_t group;
+  uint32_t n;
+  const uint32_t* times;
+  uint8_t* buf = nullptr;
+  uint8_t j;
+  m_readData = 0;
+  m_readIndex = 0;
+  if (!m_file) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (m_dataCount == 0) {
+    return true;
+  }
+  // Find the last data sector with first time less than time.
+  tailGroup = (m_dataCount - 1)/TS_GROUP_SECTORS;
+  if (m_times[0] < time) {
+    group = tailGroup;
+    times = m_times;
+    n = m_dataCount - tailGroup*TS_GROUP_SECTORS;
+  } else {
+    // Binary search of index sectors for first group not less than time.
+    hi = tailGroup;
+    while (lo < hi) {
+      uint32_t mid = lo + (hi - lo)/2;
+      buf = cacheGet(indexSector(mid), true);
+      if (!buf || getLe16(buf) != TS_INDEX_MAGIC) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      if (getLe32(buf + TS_INDEX_TIMES) < time) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    if (lo == 0) {
+      return true;
+    }
+    group = lo - 1;
+    buf = cacheGet(indexSector(group), true);
+    if (!buf) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    times = nullptr;
+    n = TS_GROUP_SECTORS;
+  }
+  for (j = 1; j < n; j++) {
+    uint32_t t = times ? times[j] : getLe32(buf + TS_INDEX_TIMES + 4*j);
+    if (t >= time) {
+      break;
+    }
+  }
+  m_readData = group*TS_GROUP_SECTORS + j - 1;
+  // Skip records in the sector that are before time.
+  buf = cacheGet(dataSector(m_readData), true);
+  if (!buf) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  while (m_readIndex < buf[TS_DATA_COUNT] &&
+         getLe32(buf + TS_DATA_RECORDS +
+                 m_readIndex*(4 + m_recordSize)) < time) {
+    m_readIndex++;
+  }
+  return true;
+
+ fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool TimeSeriesFile::sync() {
+  if (!m_file || !writeIndex() || !m_file->sync()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  return true;
+
+ fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+// Write index sector after the last data sector of a group.
+bool TimeSeriesFile::writeIndex() {
+  uint32_t group;
+  uint8_t* buf;
+  if (!cacheFlush()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (m_dataCount == 0 || m_dataCount%TS_GROUP_SECTORS) {
+    return true;
+  }
+  group = m_dataCount/TS_GROUP_SECTORS - 1;
+  if (m_file->fileSize() > ((uint64_t)indexSector(group) << 9)) {
+    // Already written.
+    return true;
+  }
+  buf = cacheGet(indexSector(group), false);
+  if (!buf) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  memset(buf, 0, 512);
+  setLe16(buf, TS_INDEX_MAGIC);
+  setLe32(buf + TS_INDEX_GROUP, group);
+  for (uint8_t i = 0; i < TS_GROUP_SECTORS; i++) {
+    setLe32(buf + TS_INDEX_TIMES + 4*i, m_times[i]);
+  }
+  m_dirty = true;
+  return cacheFlush();
+
+ fail:
+  return false;
+}
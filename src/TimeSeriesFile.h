@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef TimeSeriesFile_h
+#define TimeSeriesFile_h
+/**
+ * \file
+ * \brief Append only time series file with a sparse index.
+ */
+#include "FsLib/FsLib.h"
+/** Data sectors covered by one index sector. */
+const uint8_t TS_GROUP_SECTORS = 32;
+/**
+ * \class TimeSeriesFile
+ * \brief Append only time series file with a sparse index.
+ *
+ * Sector zero is a header.  Data is stored in groups of TS_GROUP_SECTORS
+ * data sectors followed by an index sector with the first time of each
+ * data sector in the group.  Index sectors are at fixed positions so
+ * seekTime() is a binary search with O(log n) sector reads.
+ *
+ * The file must be contiguous so sectors are read from the block device
+ * without following the cluster chain.  Appends fail if the file can't
+ * grow contiguously.  Use an exFAT file with preAllocate() or a volume
+ * with contiguous free space.
+ *
+ * Each record is a 32-bit time followed by a fixed size payload.  Times
+ * must not decrease.
+ */
+class TimeSeriesFile {
+ public:
+  TimeSeriesFile() : m_file(nullptr) {}
+  /** Start use of a file.
+   *
+   * An empty file is initialized.  Append continues at the end of an
+   * existing file.  If the file is writable, an index sector missed by
+   * an interrupted session is written.
+   *
+   * \param[in] dev Block device for the file's volume.
+   * \param[in] file Contiguous file open for read and write.
+   * \param[in] recordSize Payload bytes per record.  Use zero for the
+   *            value stored in an existing file.
+   * \return true for success or false for failure.
+   */
+  bool begin(BlockDevice* dev, FsBaseFile* file, uint16_t recordSize);
+  /** Append a record.
+   *
+   * \param[in] time Record time.  Must not be less than the previous time.
+   * \param[in] data Payload of recordSize() bytes.
+   * \return true for success or false for failure.
+   */
+  bool append(uint32_t time, const void* data);
+  /** \return Number of records in the file. */
+  uint32_t recordCount() const {
+    return m_dataCount ? (m_dataCount - 1)*m_perSector + m_tailCount : 0;
+  }
+  /** \return Payload bytes per record. */
+  uint16_t recordSize() const {return m_recordSize;}
+  /** Read the next record.
+   *
+   * \param[out] time Record time.
+   * \param[out] data Location for the payload.
+   * \return true for success or false at end of file or for failure.
+   */
+  bool read(uint32_t* time, void* data);
+  /** Position for read() at the first record with time at least \a time.
+   *
+   * \param[in] time Time to find.
+   * \return true for success or false for failure.
+   */
+  bool seekTime(uint32_t time);
+  /** Write buffered data and index then sync the file.
+   * \return true for success or false for failure.
+   */
+  bool sync();
+
+ private:
+  static const uint32_t NO_SECTOR = 0XFFFFFFFF;
+  bool cacheFlush();
+  uint8_t* cacheGet(uint32_t sector, bool read);
+  uint32_t dataSector(uint32_t d) const {
+    return 1 + (d/TS_GROUP_SECTORS)*(TS_GROUP_SECTORS + 1) +
+           d%TS_GROUP_SECTORS;
+  }
+  uint32_t indexSector(uint32_t g) const {
+    return (g + 1)*(TS_GROUP_SECTORS + 1);
+  }
+  bool writeIndex();
+
+  BlockDevice* m_dev;
+  FsBaseFile* m_file;
+  uint16_t m_recordSize;
+  uint8_t m_perSector;
+  uint8_t m_tailCount;
+  uint32_t m_dataCount;
+  uint32_t m_lastTime;
+  uint32_t m_readData;
+  uint8_t m_readIndex;
+  bool m_dirty;
+  uint32_t m_bufSector;
+  uint32_t m_times[TS_GROUP_SECTORS];
+  uint8_t m_buf[512];
+};
+#endif  // TimeSeriesFile_h
@@ -38,6 +38,20 @@
 class BlockDeviceInterface {
  public:
   virtual ~BlockDeviceInterface() {}
+  /** \return Erase allocation unit size in sectors or one if not known. */
+  virtual uint32_t auSectors() {return 1;}
+  /** Erase a range of sectors.
+   *
+   * \param[in] firstSector The address of the first sector in the range.
+   * \param[in] lastSector The address of the last sector in the range.
+   *
+   * \return true for success or false if not supported or failure.
+   */
+  virtual bool erase(uint32_t firstSector, uint32_t lastSector) {
+    (void)firstSector;
+    (void)lastSector;
+    return false;
+  }
   /**
    * Check for BlockDevice busy.
    *
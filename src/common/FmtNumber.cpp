@@ -22,6 +22,7 @@
  * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
  * DEALINGS IN THE SOFTWARE.
  */
+#include <string.h>
 #include "FmtNumber.h"
 // always use fmtBase10() - seems fast even on teensy 3.6.
 #define USE_FMT_BASE10 1
@@ -206,6 +207,79 @@ char* fmtBase10(char* str, uint32_t n) {
   return fmtBase10(str, (uint16_t)n);
 }
 //------------------------------------------------------------------------------
+#ifndef __AVR__
+// Two ASCII digits for each value 0 - 99.
+static const char digitPairs[201] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+inline char* putPair(char* dst, uint16_t n) {
+  memcpy(dst, digitPairs + 2*n, 2);
+  return dst + 2;
+}
+// Leading digits of a value less than 100.
+inline char* putLead(char* dst, uint16_t n) {
+  if (n < 10) {
+    *dst++ = n + '0';
+    return dst;
+  }
+  return putPair(dst, n);
+}
+#endif  // __AVR__
+/** Format a row of 16-bit values.
+ *
+ * Values are separated by \a sep and the row is terminated by CR LF.
+ *
+ * \param[out] dst Start of buffer with at least FMT_ROW_U16_DIM(n) bytes.
+ * \param[in] vals Values to format.
+ * \param[in] n Number of values.
+ * \param[in] sep Field separator.
+ * \return Pointer to the character following the row.
+ */
+char* fmtRowU16(char* dst, const uint16_t* vals, size_t n, char sep) {
+  for (size_t i = 0; i < n; i++) {
+    if (i) {
+      *dst++ = sep;
+    }
+    uint16_t v = vals[i];
+#ifdef __AVR__
+    // Stimmer divmod10 is faster than a table on AVR.
+    char buf[5];
+    char* str = fmtBase10(buf + sizeof(buf), v);
+    while (str < buf + sizeof(buf)) {
+      *dst++ = *str++;
+    }
+#else  // __AVR__
+    // Multiply by reciprocal.  Exact for all 16-bit values.
+    if (v < 100) {
+      dst = putLead(dst, v);
+    } else if (v < 10000) {
+      uint16_t h = ((uint32_t)(v >> 2)*5243) >> 17;
+      dst = putLead(dst, h);
+      dst = putPair(dst, v - 100*h);
+    } else {
+      uint16_t t = ((uint32_t)(v >> 4)*839) >> 19;
+      v -= 10000*t;
+      uint16_t h = ((uint32_t)(v >> 2)*5243) >> 17;
+      *dst++ = t + '0';
+      dst = putPair(dst, h);
+      dst = putPair(dst, v - 100*h);
+    }
+#endif  // __AVR__
+  }
+  *dst++ = '\r';
+  *dst++ = '\n';
+  return dst;
+}
+//------------------------------------------------------------------------------
 char* fmtHex(char* str, uint32_t n) {
   do {
     uint8_t h = n & 0XF;
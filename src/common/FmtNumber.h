@@ -38,6 +38,14 @@ char* fmtBase10(char* str, uint32_t n);
 char* fmtDouble(char *str, double d, uint8_t prec, bool altFmt);
 char* fmtDouble(char* str, double d, uint8_t prec, bool altFmt, char expChar);
 char* fmtHex(char* str, uint32_t n);
+/** Maximum length of a row formatted by fmtRowU16().
+ *
+ * Five digits and a separator or CR for each value plus LF.  An empty
+ * row is still terminated by CR LF.
+ * \param[in] n Number of values in the row.
+ */
+#define FMT_ROW_U16_DIM(n) ((n) ? 6*(n) + 1 : 2)
+char* fmtRowU16(char* dst, const uint16_t* vals, size_t n, char sep);
 char* fmtSigned(char* str, int32_t n, uint8_t base, bool caps);
 char* fmtUnsigned(char* str, uint32_t n, uint8_t base, bool caps);
 #endif  // FmtNumber_h
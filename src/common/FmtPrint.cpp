@@ -0,0 +1,220 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include "FmtPrint.h"
+// Large enough for the longest fmtDouble() exp format.
+const size_t FMT_BUF_DIM = 32;
+//------------------------------------------------------------------------------
+static bool fmtPad(FmtWrite_t wr, void* dst, char c, size_t n) {
+  char buf[8];
+  memset(buf, c, sizeof(buf));
+  while (n) {
+    size_t k = n < sizeof(buf) ? n : sizeof(buf);
+    if (wr(dst, buf, k) != k) {
+      return false;
+    }
+    n -= k;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+// Long is 64 bits on some hosts so values above 32 bits use a generic loop.
+static char* fmtLong(char* str, unsigned long n, uint8_t base, bool caps) {
+  if (n == (uint32_t)n) {
+    return base == 10 ? fmtBase10(str, (uint32_t)n) :
+                        fmtUnsigned(str, (uint32_t)n, base, caps);
+  }
+  do {
+    uint8_t d = n % base;
+    n /= base;
+    *--str = d < 10 ? '0' + d : (caps ? 'A' : 'a') + d - 10;
+  } while (n);
+  return str;
+}
+//------------------------------------------------------------------------------
+size_t fmtVprint(FmtWrite_t wr, void* dst, const char* fmt, va_list ap) {
+  char buf[FMT_BUF_DIM];
+  size_t rtn = 0;
+  while (*fmt) {
+    const char* str = fmt;
+    while (*fmt && *fmt != '%') {
+      fmt++;
+    }
+    size_t n = fmt - str;
+    if (n) {
+      if (wr(dst, str, n) != n) {
+        goto fail;
+      }
+      rtn += n;
+    }
+    if (!*fmt) {
+      break;
+    }
+    fmt++;
+    bool left = false;
+    bool plus = false;
+    bool alt = false;
+    char pad = ' ';
+    for (;; fmt++) {
+      if (*fmt == '-') {
+        left = true;
+      } else if (*fmt == '0') {
+        pad = '0';
+      } else if (*fmt == '+') {
+        plus = true;
+      } else if (*fmt == '#') {
+        alt = true;
+      } else {
+        break;
+      }
+    }
+    size_t width = 0;
+    while (isDigit(*fmt)) {
+      width = 10*width + *fmt++ - '0';
+    }
+    int prec = -1;
+    if (*fmt == '.') {
+      fmt++;
+      prec = 0;
+      while (isDigit(*fmt)) {
+        prec = 10*prec + *fmt++ - '0';
+      }
+    }
+    bool lng = false;
+    while (*fmt == 'l' || *fmt == 'h') {
+      lng = *fmt++ == 'l';
+    }
+    char* end = buf + sizeof(buf);
+    // Sign or 0x prefix.
+    char pre[2];
+    uint8_t npre = 0;
+    str = end;
+    switch (*fmt) {
+      case 'c':
+        buf[0] = va_arg(ap, int);
+        str = buf;
+        end = buf + 1;
+        break;
+
+      case 's':
+        str = va_arg(ap, const char*);
+        if (!str) {
+          str = "(null)";
+        }
+        end = const_cast<char*>(str) + strlen(str);
+        if (prec >= 0 && (end - str) > prec) {
+          end = const_cast<char*>(str) + prec;
+        }
+        break;
+
+      case 'd':
+      case 'i': {
+          long v = lng ? va_arg(ap, long) : va_arg(ap, int);
+          unsigned long u = v;
+          if (v < 0) {
+            pre[npre++] = '-';
+            u = -u;
+          } else if (plus) {
+            pre[npre++] = '+';
+          }
+          str = fmtLong(end, u, 10, false);
+        }
+        break;
+
+      case 'u': {
+          unsigned long v = lng ? va_arg(ap, unsigned long) :
+                                  va_arg(ap, unsigned);
+          str = fmtLong(end, v, 10, false);
+        }
+        break;
+
+      case 'x':
+      case 'X': {
+          unsigned long v = lng ? va_arg(ap, unsigned long) :
+                                  va_arg(ap, unsigned);
+          str = fmtLong(end, v, 16, *fmt == 'X');
+          if (alt && v) {
+            pre[npre++] = '0';
+            pre[npre++] = *fmt;
+          }
+        }
+        break;
+
+      case 'e':
+      case 'E':
+      case 'f': {
+          double v = va_arg(ap, double);
+          str = fmtDouble(end, v, prec < 0 ? 6 : prec, alt,
+                          *fmt == 'f' ? 0 : *fmt);
+          if (*str == '-') {
+            pre[npre++] = *str++;
+          } else if (plus) {
+            pre[npre++] = '+';
+          }
+        }
+        break;
+
+      case '%':
+        buf[0] = '%';
+        str = buf;
+        end = buf + 1;
+        break;
+
+      default:
+        // Invalid conversion.
+        goto fail;
+    }
+    fmt++;
+    n = end - str + npre;
+    size_t fill = width > n ? width - n : 0;
+    if (left || pad != '0') {
+      if (!left && !fmtPad(wr, dst, ' ', fill)) {
+        goto fail;
+      }
+      if (npre && wr(dst, pre, npre) != npre) {
+        goto fail;
+      }
+    } else {
+      // Zero fill goes after the sign or prefix.
+      if (npre && wr(dst, pre, npre) != npre) {
+        goto fail;
+      }
+      if (!fmtPad(wr, dst, '0', fill)) {
+        goto fail;
+      }
+    }
+    if (wr(dst, str, end - str) != (size_t)(end - str)) {
+      goto fail;
+    }
+    if (left && !fmtPad(wr, dst, ' ', fill)) {
+      goto fail;
+    }
+    rtn += n + fill;
+  }
+  return rtn;
+
+ fail:
+  return 0;
+}
@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef FmtPrint_h
+#define FmtPrint_h
+/**
+ * \file
+ * \brief Small printf style formatter.
+ */
+#include <stdarg.h>
+#include "FmtNumber.h"
+/** Write function used by fmtVprint().
+ * \param[in] dst Destination object.
+ * \param[in] buf Data to write.
+ * \param[in] n Number of bytes to write.
+ * \return Number of bytes written.
+ */
+typedef size_t (*FmtWrite_t)(void* dst, const void* buf, size_t n);
+/** Format with a printf style format string.
+ *
+ * Conversions are %%c, %%s, %%d, %%i, %%u, %%x, %%X, %%f, %%e, %%E and %%%%.
+ * Flags '-', '0', '+' and '#', field width, precision, and the length
+ * modifiers 'l', 'h' and 'hh' are supported.  Width and precision may
+ * not be '*'.  The 'l' modifier formats the full width of long on hosts
+ * with 64-bit long.  The '#' flag adds a 0x or 0X prefix to nonzero
+ * %%x and %%X values and forces a decimal point for %%f, %%e and %%E.
+ *
+ * Each field is formatted into a small buffer on the stack then written
+ * to the destination.  Literal text is written directly from \a fmt.
+ *
+ * \param[in] wr Write function.
+ * \param[in] dst Destination passed to \a wr.
+ * \param[in] fmt Format string.
+ * \param[in] ap Argument list.
+ * \return Number of bytes written or zero if an error occurs.
+ */
+size_t fmtVprint(FmtWrite_t wr, void* dst, const char* fmt, va_list ap);
+//------------------------------------------------------------------------------
+/** \cond SHOW_PROTECTED */
+template<class Dst>
+size_t fmtWriteDst(void* dst, const void* buf, size_t n) {
+  return reinterpret_cast<Dst*>(dst)->write(buf, n);
+}
+/** \endcond */
+//------------------------------------------------------------------------------
+/** Format with a printf style format string.
+ *
+ * \a dst may be any class with a write(const void*, size_t) member such as
+ * BufferedPrint, RingBuf or a file.  See fmtVprint() for supported
+ * conversions.
+ *
+ * \param[in] dst Destination.
+ * \param[in] fmt Format string.
+ * \return Number of bytes written or zero if an error occurs.
+ */
+template<class Dst>
+size_t fmtPrint(Dst* dst, const char* fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  size_t rtn = fmtVprint(fmtWriteDst<Dst>, dst, fmt, ap);
+  va_end(ap);
+  return rtn;
+}
+#endif  // FmtPrint_h
@@ -42,6 +42,10 @@
  */
 /** Use O_NONBLOCK for open at EOF */
 #define O_AT_END O_NONBLOCK  ///< Open at EOF.
+#ifndef O_DIRECT
+/** Sector aligned transfers bypass the cache. Newlib value. */
+#define O_DIRECT 0x80000
+#endif  // O_DIRECT
 typedef int oflag_t;
 #else  // USE_FCNTL_H
 #define O_RDONLY  0X00  ///< Open for reading only.
@@ -53,9 +57,10 @@ typedef int oflag_t;
 #define O_TRUNC   0x20  ///< Truncate file to zero length.
 #define O_EXCL    0x40  ///< Fail if the file exists.
 #define O_SYNC    0x80  ///< Synchronized write I/O operations.
+#define O_DIRECT  0x100  ///< Sector aligned transfers bypass the cache.
 
 #define O_ACCMODE (O_RDONLY|O_WRONLY|O_RDWR)  ///< Mask for access mode.
-typedef uint8_t oflag_t;
+typedef uint16_t oflag_t;
 #endif  // USE_FCNTL_H
 
 #define O_READ    O_RDONLY
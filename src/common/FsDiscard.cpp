@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "FsDiscard.h"
+//------------------------------------------------------------------------------
+bool FsDiscard::add(uint32_t sector, uint32_t count) {
+  uint32_t end = sector + count;
+  bool merged = false;
+  // Absorb every queued range that touches the new range so a range that
+  // bridges two queued ranges leaves one larger range.
+  for (uint8_t i = 0; i < m_count;) {
+    uint32_t iEnd = m_sector[i] + m_size[i];
+    if (m_sector[i] <= end && sector <= iEnd) {
+      if (m_sector[i] < sector) {
+        sector = m_sector[i];
+      }
+      if (iEnd > end) {
+        end = iEnd;
+      }
+      m_count--;
+      m_sector[i] = m_sector[m_count];
+      m_size[i] = m_size[m_count];
+      merged = true;
+    } else {
+      i++;
+    }
+  }
+  if (m_count == RANGE_COUNT) {
+    return false;
+  }
+  m_sector[m_count] = sector;
+  m_size[m_count] = end - sector;
+  m_count++;
+  if (!merged) {
+    m_stats.queued++;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+void FsDiscard::cancel(uint32_t sector, uint32_t count) {
+  for (uint8_t i = 0; i < m_count;) {
+    if (sector < (m_sector[i] + m_size[i]) && m_sector[i] < (sector + count)) {
+      m_count--;
+      m_sector[i] = m_sector[m_count];
+      m_size[i] = m_size[m_count];
+      m_stats.cancelled++;
+    } else {
+      i++;
+    }
+  }
+}
+//------------------------------------------------------------------------------
+bool FsDiscard::pop(uint32_t* sector, uint32_t* count) {
+  if (m_count == 0) {
+    return false;
+  }
+  m_count--;
+  *sector = m_sector[m_count];
+  *count = m_size[m_count];
+  return true;
+}
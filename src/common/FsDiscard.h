@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef FsDiscard_h
+#define FsDiscard_h
+/**
+ * \file
+ * \brief Queue of freed sector ranges for discard.
+ */
+#include <string.h>
+#include "SysCall.h"
+/** Freed clusters are not erased. */
+const uint8_t DISCARD_OFF = 0;
+/** Freed clusters are erased when they are freed. */
+const uint8_t DISCARD_INLINE = 1;
+/** Freed clusters are erased when the volume cache is synced. */
+const uint8_t DISCARD_AT_SYNC = 2;
+/** Freed clusters are erased by calls to discard(). */
+const uint8_t DISCARD_IDLE = 3;
+/** Discard counters. */
+struct FsDiscardStats_t {
+  /** Ranges queued. */
+  uint32_t queued;
+  /** Ranges dropped because clusters were allocated again. */
+  uint32_t cancelled;
+  /** Ranges erased. */
+  uint32_t erased;
+  /** Sectors erased. */
+  uint32_t sectors;
+  /** Erase failures. */
+  uint32_t failures;
+};
+/**
+ * \class FsDiscard
+ * \brief Queue of freed sector ranges for discard.
+ */
+class FsDiscard {
+ public:
+  FsDiscard() : m_count(0), m_policy(DISCARD_AT_SYNC) {
+    memset(&m_stats, 0, sizeof(m_stats));
+  }
+  /** Queue a range, merging it with adjacent ranges if possible.
+   *
+   * Ranges are not widened to allocation unit boundaries since the gap
+   * may hold file data.  Partial allocation units are skipped by erase.
+   *
+   * \param[in] sector First sector of range.
+   * \param[in] count Number of sectors.
+   * \return false if the queue is full.
+   */
+  bool add(uint32_t sector, uint32_t count);
+  /** Drop ranges that overlap allocated sectors.
+   *
+   * \param[in] sector First sector allocated.
+   * \param[in] count Number of sectors allocated.
+   */
+  void cancel(uint32_t sector, uint32_t count);
+  /** Remove all ranges. */
+  void clear() {m_count = 0;}
+  /** \return true if no ranges are queued. */
+  bool empty() const {return m_count == 0;}
+  /** \return Discard policy. */
+  uint8_t policy() const {return m_policy;}
+  /** Remove a range from the queue.
+   *
+   * \param[out] sector First sector of range.
+   * \param[out] count Number of sectors.
+   * \return false if the queue is empty.
+   */
+  bool pop(uint32_t* sector, uint32_t* count);
+  /** Set discard policy.
+   * \param[in] policy DISCARD_OFF, DISCARD_INLINE, DISCARD_AT_SYNC
+   * or DISCARD_IDLE.
+   */
+  void setPolicy(uint8_t policy) {
+    m_policy = policy;
+    if (policy == DISCARD_OFF) {
+      clear();
+    }
+  }
+  /** \return Discard counters. */
+  FsDiscardStats_t* stats() {return &m_stats;}
+
+ private:
+  static const uint8_t RANGE_COUNT = 8;
+  uint32_t m_sector[RANGE_COUNT];
+  uint32_t m_size[RANGE_COUNT];
+  uint8_t m_count;
+  uint8_t m_policy;
+  FsDiscardStats_t m_stats;
+};
+#endif  // FsDiscard_h
@@ -0,0 +1,119 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "FsExtents.h"
+//------------------------------------------------------------------------------
+void FsFreeExtents::add(uint32_t cluster, uint32_t count) {
+  uint32_t end = cluster + count;
+  if (count == 0) {
+    return;
+  }
+  for (uint8_t i = 0; i < m_count;) {
+    uint32_t e = m_start[i] + m_size[i];
+    if (m_start[i] <= end && cluster <= e) {
+      // Free extents that touch are one extent.
+      if (m_start[i] < cluster) {
+        cluster = m_start[i];
+      }
+      if (e > end) {
+        end = e;
+      }
+      erase(i);
+    } else {
+      i++;
+    }
+  }
+  insert(cluster, end - cluster);
+}
+//------------------------------------------------------------------------------
+void FsFreeExtents::erase(uint8_t i) {
+  m_count--;
+  for (; i < m_count; i++) {
+    m_start[i] = m_start[i + 1];
+    m_size[i] = m_size[i + 1];
+  }
+}
+//------------------------------------------------------------------------------
+bool FsFreeExtents::find(uint32_t count, uint32_t* cluster) const {
+  uint8_t best = EXTENT_COUNT;
+  for (uint8_t i = 0; i < m_count; i++) {
+    if (m_size[i] >= count &&
+        (best == EXTENT_COUNT || m_size[i] < m_size[best])) {
+      best = i;
+    }
+  }
+  if (best == EXTENT_COUNT) {
+    return false;
+  }
+  *cluster = m_start[best];
+  return true;
+}
+//------------------------------------------------------------------------------
+void FsFreeExtents::insert(uint32_t cluster, uint32_t count) {
+  uint8_t i;
+  if (m_count == EXTENT_COUNT) {
+    uint8_t small = 0;
+    for (i = 1; i < m_count; i++) {
+      if (m_size[i] < m_size[small]) {
+        small = i;
+      }
+    }
+    if (m_size[small] >= count) {
+      return;
+    }
+    erase(small);
+  }
+  for (i = m_count; i > 0 && m_start[i - 1] > cluster; i--) {
+    m_start[i] = m_start[i - 1];
+    m_size[i] = m_size[i - 1];
+  }
+  m_start[i] = cluster;
+  m_size[i] = count;
+  m_count++;
+}
+//------------------------------------------------------------------------------
+void FsFreeExtents::remove(uint32_t cluster, uint32_t count) {
+  uint32_t end = cluster + count;
+  for (uint8_t i = 0; i < m_count;) {
+    uint32_t s = m_start[i];
+    uint32_t e = s + m_size[i];
+    if (end <= s || e <= cluster) {
+      i++;
+    } else if (s < cluster && end < e) {
+      // Split extent, the part before cluster stays at index i.
+      m_size[i] = cluster - s;
+      insert(end, e - end);
+      return;
+    } else if (s < cluster) {
+      m_size[i] = cluster - s;
+      i++;
+    } else if (end < e) {
+      m_start[i] = end;
+      m_size[i] = e - end;
+      i++;
+    } else {
+      erase(i);
+    }
+  }
+}
@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef FsExtents_h
+#define FsExtents_h
+/**
+ * \file
+ * \brief Index of free cluster extents.
+ */
+#include "SysCall.h"
+/**
+ * \class FsFreeExtents
+ * \brief Bounded index of known free cluster extents.
+ *
+ * Extents are disjoint, not adjacent and sorted by start cluster.  When the
+ * index is full the smallest extent is dropped for a larger one.
+ */
+class FsFreeExtents {
+ public:
+  FsFreeExtents() : m_count(0) {}
+  /** Record a free extent, merging it with touching extents.
+   *
+   * \param[in] cluster First cluster of extent.
+   * \param[in] count Number of clusters.
+   */
+  void add(uint32_t cluster, uint32_t count);
+  /** Remove all extents. */
+  void clear() {m_count = 0;}
+  /** Find the smallest extent that holds count clusters.
+   *
+   * \param[in] count Number of clusters needed.
+   * \param[out] cluster First cluster of extent.
+   * \return true if an extent was found.
+   */
+  bool find(uint32_t count, uint32_t* cluster) const;
+  /** Remove allocated clusters from the index.
+   *
+   * \param[in] cluster First cluster allocated.
+   * \param[in] count Number of clusters allocated.
+   */
+  void remove(uint32_t cluster, uint32_t count);
+
+ private:
+  static const uint8_t EXTENT_COUNT = 8;
+  void erase(uint8_t i);
+  void insert(uint32_t cluster, uint32_t count);
+  uint32_t m_start[EXTENT_COUNT];
+  uint32_t m_size[EXTENT_COUNT];
+  uint8_t m_count;
+};
+#endif  // FsExtents_h
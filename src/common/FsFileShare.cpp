@@ -0,0 +1,48 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "FsFileShare.h"
+//------------------------------------------------------------------------------
+uint8_t FsFileShare::attach(uint32_t sector, uint16_t offset) {
+  uint8_t free = 0;
+  for (uint8_t i = 0; i < SHARE_COUNT; i++) {
+    FsShareEntry_t* e = &m_entry[i];
+    if (e->refs == 0) {
+      if (!free) {
+        free = i + 1;
+      }
+    } else if (e->sector == sector && e->offset == offset) {
+      e->refs++;
+      return i + 1;
+    }
+  }
+  if (free) {
+    FsShareEntry_t* e = entry(free);
+    memset(e, 0, sizeof(FsShareEntry_t));
+    e->sector = sector;
+    e->offset = offset;
+    e->refs = 1;
+  }
+  return free;
+}
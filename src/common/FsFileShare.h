@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef FsFileShare_h
+#define FsFileShare_h
+/**
+ * \file
+ * \brief Open file table for state shared by handles on the same file.
+ */
+#include <string.h>
+#include "SysCall.h"
+/** State shared by handles open on one directory entry. */
+struct FsShareEntry_t {
+  /** Sector of the directory entry, zero if the entry is free. */
+  uint32_t sector;
+  /** Offset of the directory entry in its sector. */
+  uint16_t offset;
+  /** Count of attached handles. */
+  uint8_t refs;
+  /** Incremented when the file is truncated. */
+  uint8_t truncCount;
+  /** First cluster of the file. */
+  uint32_t firstCluster;
+  /** File size for FAT or valid length for exFAT. */
+  uint64_t size;
+  /** Data length for exFAT. */
+  uint64_t dataLength;
+  /** Shared file flags. */
+  uint8_t flags;
+};
+/**
+ * \class FsShareId
+ * \brief Open file table entry id held by a file.
+ *
+ * A copy of a file does not hold a reference to the entry so the id is
+ * zero in the copy.  Only the original detaches from the entry.
+ */
+class FsShareId {
+ public:
+  FsShareId() : m_id(0) {}
+  /** Copy does not share the entry. */
+  FsShareId(const FsShareId&) : m_id(0) {}
+  /** Assignment from a file does not share the entry.
+   * \return this id.
+   */
+  FsShareId& operator=(const FsShareId&) {
+    m_id = 0;
+    return *this;
+  }
+  /** Set the id.
+   * \param[in] id Entry id from attach().
+   * \return this id.
+   */
+  FsShareId& operator=(uint8_t id) {
+    m_id = id;
+    return *this;
+  }
+  /** \return Entry id or zero if none. */
+  operator uint8_t() const {return m_id;}
+
+ private:
+  uint8_t m_id;
+};
+/**
+ * \class FsFileShare
+ * \brief Open file table for a volume.
+ */
+class FsFileShare {
+ public:
+  FsFileShare() {clear();}
+  /** Attach a handle to the entry for a directory entry.
+   *
+   * \param[in] sector Sector of the directory entry.
+   * \param[in] offset Offset of the directory entry in its sector.
+   * \return Entry id or zero if the table is full.
+   */
+  uint8_t attach(uint32_t sector, uint16_t offset);
+  /** Remove all entries. */
+  void clear() {
+    memset(m_entry, 0, sizeof(m_entry));
+  }
+  /** Detach a handle from an entry.
+   *
+   * \param[in] id Entry id from attach().
+   */
+  void detach(uint8_t id) {
+    FsShareEntry_t* e = entry(id);
+    if (e->refs && --e->refs == 0) {
+      e->sector = 0;
+    }
+  }
+  /** Entry for an id.
+   *
+   * \param[in] id Entry id from attach().
+   * \return Pointer to the entry.
+   */
+  FsShareEntry_t* entry(uint8_t id) {return &m_entry[id - 1];}
+
+ private:
+  static const uint8_t SHARE_COUNT = 4;
+  FsShareEntry_t m_entry[SHARE_COUNT];
+};
+#endif  // FsFileShare_h
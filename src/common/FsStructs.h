@@ -301,6 +301,27 @@ typedef struct ExFatBootSector {
   uint8_t  signature[2];
 } ExFatPbs_t;
 //-----------------------------------------------------------------------------
+/** OEM Parameters sector offset in the exFAT boot region. */
+const uint8_t EXFAT_OEM_PARAMETERS_SECTOR = 9;
+/** Boot checksum sector offset in the exFAT boot region. */
+const uint8_t EXFAT_BOOT_CHECKSUM_SECTOR = 11;
+/** Backup boot region offset from the main boot region. */
+const uint8_t EXFAT_BACKUP_BOOT_SECTOR = 12;
+/** Number of parameter records in the OEM Parameters sector. */
+const uint8_t EXFAT_OEM_PARAMETER_COUNT = 10;
+/** GUID for the SdFat mount hint parameter record. */
+const uint8_t EXFAT_HINT_GUID[16] = {
+  0X5D, 0X2B, 0X6C, 0XA1, 0X0E, 0X94, 0X4F, 0X3B,
+  0X9A, 0X71, 0XC2, 0X48, 0X1F, 0X63, 0XE5, 0X07
+};
+typedef struct {
+  uint8_t  guid[16];
+  uint8_t  nextFree[4];
+  uint8_t  freeCount[4];
+  uint8_t  percentInUse;
+  uint8_t  reserved[23];
+} ExFatHint_t;
+//-----------------------------------------------------------------------------
 const uint32_t EXFAT_EOC = 0XFFFFFFFF;
 
 const uint8_t EXFAT_TYPE_BITMAP = 0X81;
@@ -0,0 +1,139 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#define DBG_FILE "QueuedBlockDevice.cpp"
+#include "DebugMacros.h"
+#include <string.h>
+#include "QueuedBlockDevice.h"
+//------------------------------------------------------------------------------
+int QueuedBlockDeviceBase::find(uint32_t sector) const {
+  for (uint16_t i = 0; i < m_count; i++) {
+    if (m_sectors[i] == sector) {
+      return i;
+    }
+  }
+  return -1;
+}
+//------------------------------------------------------------------------------
+bool QueuedBlockDeviceBase::flush() {
+  uint16_t i = 0;
+  sort();
+  while (i < m_count) {
+    uint16_t n = 1;
+    while ((i + n) < m_count && m_sectors[i + n] == m_sectors[i] + n) {
+      n++;
+    }
+    uint8_t* src = m_buf + 512UL*i;
+    if (n == 1 ? !m_dev->writeSector(m_sectors[i], src) :
+        !m_dev->writeSectors(m_sectors[i], src, n)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    i += n;
+  }
+  m_count = 0;
+  return true;
+
+ fail:
+  // Keep unwritten sectors queued.
+  memmove(m_buf, m_buf + 512UL*i, 512UL*(m_count - i));
+  memmove(m_sectors, m_sectors + i, sizeof(uint32_t)*(m_count - i));
+  m_count -= i;
+  return false;
+}
+//------------------------------------------------------------------------------
+bool QueuedBlockDeviceBase::readSectors(uint32_t sector, uint8_t* dst,
+                                        size_t ns) {
+  if (!m_dev->readSectors(sector, dst, ns)) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  // Replace with queued data.
+  for (uint16_t i = 0; i < m_count; i++) {
+    if ((m_sectors[i] - sector) < ns) {
+      memcpy(dst + 512UL*(m_sectors[i] - sector), m_buf + 512UL*i, 512);
+    }
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+void QueuedBlockDeviceBase::remove(uint16_t i) {
+  m_count--;
+  if (i != m_count) {
+    memcpy(m_buf + 512UL*i, m_buf + 512UL*m_count, 512);
+    m_sectors[i] = m_sectors[m_count];
+  }
+}
+//------------------------------------------------------------------------------
+// Selection sort by sector.  Sectors are unique and the queue is short.
+void QueuedBlockDeviceBase::sort() {
+  for (uint16_t i = 0; i + 1 < m_count; i++) {
+    uint16_t k = i;
+    for (uint16_t j = i + 1; j < m_count; j++) {
+      if (m_sectors[j] < m_sectors[k]) {
+        k = j;
+      }
+    }
+    if (k != i) {
+      uint8_t* a = m_buf + 512UL*i;
+      uint8_t* b = m_buf + 512UL*k;
+      for (uint16_t w = 0; w < 512; w++) {
+        uint8_t t = a[w];
+        a[w] = b[w];
+        b[w] = t;
+      }
+      uint32_t t = m_sectors[i];
+      m_sectors[i] = m_sectors[k];
+      m_sectors[k] = t;
+    }
+  }
+}
+//------------------------------------------------------------------------------
+bool QueuedBlockDeviceBase::writeSectors(uint32_t sector, const uint8_t* src,
+                                         size_t ns) {
+  if (ns > m_size) {
+    // Queued copies of these sectors are stale.
+    for (uint16_t i = 0; i < m_count;) {
+      if ((m_sectors[i] - sector) < ns) {
+        remove(i);
+      } else {
+        i++;
+      }
+    }
+    return m_dev->writeSectors(sector, src, ns);
+  }
+  for (size_t k = 0; k < ns; k++, sector++, src += 512) {
+    int i = find(sector);
+    if (i < 0) {
+      if (m_count == m_size && !flush()) {
+        DBG_FAIL_MACRO;
+        return false;
+      }
+      i = m_count++;
+      m_sectors[i] = sector;
+    }
+    memcpy(m_buf + 512UL*i, src, 512);
+  }
+  return true;
+}
@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2011-2020 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef QueuedBlockDevice_h
+#define QueuedBlockDevice_h
+/**
+ * \file
+ * \brief Write queue with sector sorting and merging.
+ */
+#include "BlockDeviceInterface.h"
+/**
+ * \class QueuedBlockDeviceBase
+ * \brief Write queue with sector sorting and merging.
+ *
+ * Sector writes are held in a queue.  When the queue is full or
+ * syncDevice() is called, queued sectors are written in sector order
+ * and runs of adjacent sectors are written with one writeSectors()
+ * call.  A write to a queued sector replaces the queued data.
+ *
+ * Reads return queued data so the file system sees its own writes.
+ * syncDevice() is a barrier, no write is moved across it.
+ *
+ * Use requires USE_BLOCK_DEVICE_INTERFACE nonzero in SdFatConfig.h.
+ */
+class QueuedBlockDeviceBase : public BlockDeviceInterface {
+ public:
+  /** Initialize the queue.
+   *
+   * \param[in] dev Device for queued writes.
+   */
+  void begin(BlockDeviceInterface* dev) {
+    m_dev = dev;
+    m_count = 0;
+  }
+  /** \return Erase allocation unit size in sectors or one if not known. */
+  uint32_t auSectors() {return m_dev->auSectors();}
+  /** Write queued sectors then erase a range of sectors.
+   *
+   * \param[in] firstSector The address of the first sector in the range.
+   * \param[in] lastSector The address of the last sector in the range.
+   *
+   * \return true for success or false for failure.
+   */
+  bool erase(uint32_t firstSector, uint32_t lastSector) {
+    return flush() && m_dev->erase(firstSector, lastSector);
+  }
+  /** Write all queued sectors.
+   * \return true for success or false for failure.
+   */
+  bool flush();
+  /**
+   * Check for BlockDevice busy.
+   *
+   * \return true if busy else false.
+   */
+  bool isBusy() {return m_dev->isBusy();}
+  /** \return Number of sectors in the queue. */
+  uint16_t queued() const {return m_count;}
+  /**
+   * Read a sector.
+   *
+   * \param[in] sector Logical sector to be read.
+   * \param[out] dst Pointer to the location that will receive the data.
+   * \return true for success or false for failure.
+   */
+  bool readSector(uint32_t sector, uint8_t* dst) {
+    return readSectors(sector, dst, 1);
+  }
+  /**
+   * Read multiple sectors.
+   *
+   * \param[in] sector Logical sector to be read.
+   * \param[in] ns Number of sectors to be read.
+   * \param[out] dst Pointer to the location that will receive the data.
+   * \return true for success or false for failure.
+   */
+  bool readSectors(uint32_t sector, uint8_t* dst, size_t ns);
+  /** \return device size in sectors. */
+  uint32_t sectorCount() {return m_dev->sectorCount();}
+  /** Write queued sectors and end multi-sector transfer.
+   * \return true for success or false for failure.
+   */
+  bool syncDevice() {return flush() && m_dev->syncDevice();}
+  /**
+   * Queue a sector write.
+   *
+   * \param[in] sector Logical sector to be written.
+   * \param[in] src Pointer to the location of the data to be written.
+   * \return true for success or false for failure.
+   */
+  bool writeSector(uint32_t sector, const uint8_t* src) {
+    return writeSectors(sector, src, 1);
+  }
+  /**
+   * Write multiple sectors.  Writes larger than the queue bypass it.
+   *
+   * \param[in] sector Logical sector to be written.
+   * \param[in] ns Number of sectors to be written.
+   * \param[in] src Pointer to the location of the data to be written.
+   * \return true for success or false for failure.
+   */
+  bool writeSectors(uint32_t sector, const uint8_t* src, size_t ns);
+
+ protected:
+  /** \cond SHOW_PROTECTED */
+  QueuedBlockDeviceBase(uint8_t* buf, uint32_t* sectors, uint16_t size) :
+    m_dev(nullptr), m_buf(buf), m_sectors(sectors), m_size(size),
+    m_count(0) {}
+  /** \endcond */
+
+ private:
+  int find(uint32_t sector) const;
+  void remove(uint16_t i);
+  void sort();
+
+  BlockDeviceInterface* m_dev;
+  uint8_t* m_buf;
+  uint32_t* m_sectors;
+  uint16_t m_size;
+  uint16_t m_count;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class QueuedBlockDevice
+ * \brief Write queue with depth of \a N sectors.
+ */
+template<uint16_t N>
+class QueuedBlockDevice : public QueuedBlockDeviceBase {
+ public:
+  QueuedBlockDevice() : QueuedBlockDeviceBase(m_bufArray, m_sectorArray, N) {}
+  /** Constructor.
+   *
+   * \param[in] dev Device for queued writes.
+   */
+  explicit QueuedBlockDevice(BlockDeviceInterface* dev) :
+    QueuedBlockDeviceBase(m_bufArray, m_sectorArray, N) {
+    begin(dev);
+  }
+
+ private:
+  uint8_t m_bufArray[512*N];
+  uint32_t m_sectorArray[N];
+};
+#endif  // QueuedBlockDevice_h